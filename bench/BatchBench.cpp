@@ -0,0 +1,149 @@
+#include <Bench.hpp>
+#include <BoardBatch.hpp>
+#include <chrono>
+#include <cstdio>
+
+using namespace snake;
+
+/*
+ * BoardBatch against the Board it replaces in training. Both sides get the
+ * same seeds and the same random turns; every tick the heads, lengths, fruit,
+ * scores, network inputs and teacher directions of each board must match.
+ * Then both step the same number of boards with no per-tick checks, timing
+ * Snake::update over a vector of Boards against one BoardBatch::step.
+ */
+static const auto checkedBoards = 64;
+static const auto checkedTicks = 4000;
+static const auto timedTicks = 256;
+
+static int compareRun(const int &gridWidth, const int &gridHeight)
+{
+  std::vector<std::unique_ptr<Board>> boards;
+  std::vector<Random> randoms;
+  for (int index = 0; index < checkedBoards; ++index)
+  {
+    randoms.emplace_back(gridWidth, index);
+    boards.push_back(std::make_unique<Board>(gridWidth, gridHeight, true, randoms.back()));
+  }
+  BoardBatch batch(gridWidth, gridHeight, randoms);
+  Random turns(7);
+  auto bestScore = 0;
+  for (int tick = 0; tick < checkedTicks; ++tick)
+  {
+    for (int index = 0; index < checkedBoards; ++index)
+    {
+      auto &board = *boards[index];
+      auto &aiSnake = (AISnake &)*board.snake;
+      auto head = aiSnake.segments.front();
+      auto expectedInputs = aiSnake.computeInputs();
+      float inputs[SampleBatch::inputsCount];
+      batch.computeInputs(index, inputs);
+      auto mismatch = !(head == iPoint2D{batch.headX[index], batch.headY[index]}) ||
+                      aiSnake.segments.size() != batch.bodyLength[index] ||
+                      !(board.fruit == iPoint2D{batch.fruitX[index], batch.fruitY[index]}) ||
+                      board.score != batch.scores[index];
+      for (unsigned int input = 0; input < SampleBatch::inputsCount; ++input)
+      {
+        mismatch = mismatch || float(expectedInputs[input]) != inputs[input];
+      }
+      auto expectedOutputs = aiSnake.computeExpectedOutputs(head);
+      auto label = batch.expectedDirection(index);
+      for (int output = 0; output < 4; ++output)
+      {
+        mismatch = mismatch || (expectedOutputs[output] == 1) != (label == output);
+      }
+      if (mismatch)
+      {
+        std::fprintf(stderr, "Batch board %d diverged from Board on %dx%d at tick %d\n", index, gridWidth, gridHeight, tick);
+        return 1;
+      }
+      // Mostly follow the teacher so snakes grow and eat, sometimes turn at random
+      auto turn = turns.below(4) == 0 || label < 0 ? Direction(1 + turns.below(4)) : Direction(1 + label);
+      aiSnake.inputs.push(turn);
+      batch.turn(index, turn);
+      aiSnake.update();
+      bestScore = std::max(bestScore, board.score);
+    }
+    batch.step();
+  }
+  // A run where no snake ever ate would not have compared fruit placement at all
+  if (bestScore < 2)
+  {
+    std::fprintf(stderr, "Batch comparison on %dx%d never grew a snake\n", gridWidth, gridHeight);
+    return 1;
+  }
+  return 0;
+};
+
+int snake::runBatchBench()
+{
+  auto previousTrainingAI = trainingAI;
+  trainingAI = true;
+  int result = 0;
+  for (auto [gridWidth, gridHeight] : {std::pair{20, 20}, std::pair{37, 23}, std::pair{64, 64}})
+  {
+    result |= compareRun(gridWidth, gridHeight);
+  }
+  std::printf("%8s %8s %14s %14s %10s\n", "grid", "boards", "Board ns/tick", "batch ns/tick", "speedup");
+  for (int gridCells : {20, 64})
+  {
+    for (int boardsCount : {256, 4096})
+    {
+      std::vector<std::unique_ptr<Board>> boards;
+      std::vector<Random> randoms;
+      for (int index = 0; index < boardsCount; ++index)
+      {
+        randoms.emplace_back(gridCells, index);
+        boards.push_back(std::make_unique<Board>(gridCells, gridCells, true, randoms.back()));
+      }
+      BoardBatch batch(gridCells, gridCells, randoms);
+      // The same turn sequence for both, drawn up front so only stepping is timed
+      Random turns(11);
+      std::vector<Direction> turnSequence(size_t(timedTicks) * boardsCount);
+      for (auto &turn : turnSequence)
+      {
+        turn = turns.below(8) == 0 ? Direction(1 + turns.below(4)) : Direction::None;
+      }
+      auto startTime = std::chrono::steady_clock::now();
+      for (int tick = 0; tick < timedTicks; ++tick)
+      {
+        for (int index = 0; index < boardsCount; ++index)
+        {
+          auto turn = turnSequence[size_t(tick) * boardsCount + index];
+          if (turn != Direction::None)
+          {
+            boards[index]->snake->inputs.push(turn);
+          }
+          boards[index]->snake->update();
+        }
+      }
+      auto boardTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+      startTime = std::chrono::steady_clock::now();
+      for (int tick = 0; tick < timedTicks; ++tick)
+      {
+        for (int index = 0; index < boardsCount; ++index)
+        {
+          batch.turn(index, turnSequence[size_t(tick) * boardsCount + index]);
+        }
+        batch.step();
+      }
+      auto batchTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+      for (int index = 0; index < boardsCount; ++index)
+      {
+        if (boards[index]->score != batch.scores[index] || boards[index]->snake->segments.size() != batch.bodyLength[index])
+        {
+          std::fprintf(stderr, "Timed batch board %d diverged from Board\n", index);
+          result = 1;
+          break;
+        }
+      }
+      char grid[32];
+      std::snprintf(grid, sizeof(grid), "%dx%d", gridCells, gridCells);
+      auto boardTicks = double(timedTicks) * boardsCount;
+      std::printf("%8s %8d %14.1f %14.1f %9.1fx\n", grid, boardsCount, boardTime / boardTicks, batchTime / boardTicks,
+                  boardTime / batchTime);
+    }
+  }
+  trainingAI = previousTrainingAI;
+  return result;
+};
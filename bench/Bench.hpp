@@ -0,0 +1,60 @@
+#pragma once
+#include <Snake.hpp>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+namespace snake
+{
+	// Each benchmark prints its own table and returns non-zero on a failed sanity check
+	int runCollisionBench();
+	int runPlannerBench();
+	int runFeatureBench();
+	int runInferenceBench();
+	int runTrainingBench();
+	int runReplayBench();
+	int runInputBench();
+	int runBatchBench();
+	int runMicroBench();
+	int runMacroBench();
+	// One measurement for snake_bench --json, parameters such as the grid or thread count tell rows of a name apart
+	struct BenchResult
+	{
+		std::string bench;
+		std::string name;
+		std::string unit;
+		double value;
+		std::vector<std::pair<std::string, std::string>> parameters;
+	};
+	void recordResult(const BenchResult &result);
+	// Rough number of cell visits a timed loop may cost, loops over larger grids make fewer calls
+	static constexpr int operationsBudget = 1 << 22;
+	// Mean wall time of call(index) for index in [0, calls)
+	template <typename F>
+	double nanosecondsPerCall(const int &calls, F &&call)
+	{
+		auto startTime = std::chrono::steady_clock::now();
+		for (int index = 0; index < calls; ++index)
+		{
+			call(index);
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / calls;
+	}
+	/*
+	 * Lays an AI board's snake along row 0, gridWidth - 1 long and heading
+	 * right, with the fruit in another row, so updating it loops forever
+	 * without colliding or eating.
+	 */
+	inline void loopAlongFirstRow(Board &board)
+	{
+		auto &snake = *board.snake;
+		snake.segments.clear();
+		board.occupancy.clear();
+		for (int x = 0; x < board.gridWidth - 1; ++x)
+		{
+			snake.pushFront({x, 0});
+		}
+		snake.direction = Direction::Right;
+		board.placeFruit({0, board.gridHeight / 2});
+	}
+}
@@ -0,0 +1,79 @@
+#include <Bench.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace snake;
+
+/*
+ * Compares the old linear std::find self-collision check against the
+ * Board::occupancy lookup used by Snake::update, for snake lengths 2..400
+ * on the default 20x20 board
+ */
+static const auto gridCells = 20;
+static const auto queriesCount = 4096;
+static const auto repeats = 200;
+
+template <typename F>
+static double nanosecondsPerQuery(const std::vector<iPoint2D> &queries, F &&isOccupied, size_t &hits)
+{
+  auto startTime = std::chrono::steady_clock::now();
+  for (int repeat = 0; repeat < repeats; ++repeat)
+  {
+    for (auto &query : queries)
+    {
+      hits += isOccupied(query);
+    }
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+  return elapsed / (double(queries.size()) * repeats);
+};
+
+int snake::runCollisionBench()
+{
+  Board board(gridCells, gridCells, true, Random(1));
+  auto &snake = *board.snake;
+  // Serpentine order so every prefix is a valid snake body
+  std::vector<iPoint2D> path;
+  for (int y = 0; y < gridCells; ++y)
+  {
+    for (int i = 0; i < gridCells; ++i)
+    {
+      path.push_back({y % 2 ? gridCells - 1 - i : i, y});
+    }
+  }
+  std::mt19937 generator(1234);
+  std::uniform_int_distribution<int> cellDistribution(0, gridCells - 1);
+  std::vector<iPoint2D> queries(queriesCount);
+  for (auto &query : queries)
+  {
+    query = {cellDistribution(generator), cellDistribution(generator)};
+  }
+  std::printf("%8s %14s %14s %10s\n", "length", "find ns/query", "bitboard ns", "speedup");
+  for (int length : {2, 5, 10, 25, 50, 100, 200, 300, 400})
+  {
+    snake.segments.clear();
+    board.occupancy.clear();
+    for (int i = 0; i < length; ++i)
+    {
+      snake.pushFront(path[i]);
+    }
+    size_t findHits = 0, occupancyHits = 0;
+    auto findTime = nanosecondsPerQuery(queries, [&](const iPoint2D &point)
+    {
+      return std::find(snake.segments.begin(), snake.segments.end(), point) != snake.segments.end();
+    }, findHits);
+    auto occupancyTime = nanosecondsPerQuery(queries, [&](const iPoint2D &point)
+    {
+      return snake.occupies(point);
+    }, occupancyHits);
+    if (findHits != occupancyHits)
+    {
+      std::fprintf(stderr, "Mismatch at length %d: %zu vs %zu hits\n", length, findHits, occupancyHits);
+      return 1;
+    }
+    std::printf("%8d %14.2f %14.2f %9.1fx\n", length, findTime, occupancyTime, findTime / occupancyTime);
+  }
+  return 0;
+};
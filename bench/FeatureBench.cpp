@@ -0,0 +1,87 @@
+#include <Bench.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace snake;
+
+/*
+ * Checks that AISnake::computeInputs (bitboard ray casts) matches the
+ * original per-direction std::find scans exactly, then times both
+ */
+static const auto statesCount = 2000;
+static const auto repeats = 20;
+
+static std::vector<long double> legacyInputs(AISnake &aiSnake)
+{
+  auto &board = aiSnake.board;
+  auto &segments = aiSnake.segments;
+  auto head = segments.front();
+  return {
+    aiSnake.computeDistanceToWallUp(head, board.gridHeight), aiSnake.computeDistanceToWallDown(head, board.gridHeight),
+    aiSnake.computeDistanceToWallLeft(head, board.gridWidth), aiSnake.computeDistanceToWallRight(head, board.gridWidth),
+    aiSnake.computeDistanceToSnakeUp(head, segments), aiSnake.computeDistanceToSnakeDown(head, segments, board.gridHeight),
+    aiSnake.computeDistanceToSnakeLeft(head, segments), aiSnake.computeDistanceToSnakeRight(head, segments, board.gridWidth),
+    aiSnake.computeRelativeFruitX(head, board.fruit, board.gridWidth), aiSnake.computeRelativeFruitY(head, board.fruit, board.gridHeight),
+    aiSnake.computeDirectionX(aiSnake.direction), aiSnake.computeDirectionY(aiSnake.direction),
+    aiSnake.computeSnakeLength(segments)
+  };
+};
+
+// Lays a body of the given length along a serpentine path starting at offset
+static void layBody(Board &board, const int &offset, const int &length)
+{
+  auto &snake = *board.snake;
+  auto cellsCount = board.gridWidth * board.gridHeight;
+  snake.segments.clear();
+  board.occupancy.clear();
+  for (int i = 0; i < length; ++i)
+  {
+    auto cell = (offset + i) % cellsCount;
+    auto y = cell / board.gridWidth;
+    auto x = cell % board.gridWidth;
+    snake.pushFront({y % 2 ? board.gridWidth - 1 - x : x, y});
+  }
+  board.setFruitToRandom();
+};
+
+int snake::runFeatureBench()
+{
+  std::mt19937 generator(7);
+  std::printf("%9s %14s %14s %10s\n", "grid", "legacy ns", "bitboard ns", "speedup");
+  for (int gridCells : {20, 37, 64, 100})
+  {
+    Board board(gridCells, gridCells, true, Random(gridCells));
+    auto &aiSnake = (AISnake &)*board.snake;
+    auto cellsCount = gridCells * gridCells;
+    std::chrono::steady_clock::duration legacyTime{}, bitboardTime{};
+    for (int state = 0; state < statesCount; ++state)
+    {
+      layBody(board, generator() % cellsCount, 2 + generator() % (cellsCount / 2));
+      aiSnake.direction = Direction(1 + generator() % 4);
+      auto startTime = std::chrono::steady_clock::now();
+      std::vector<long double> expected;
+      for (int repeat = 0; repeat < repeats; ++repeat)
+      {
+        expected = legacyInputs(aiSnake);
+      }
+      auto middleTime = std::chrono::steady_clock::now();
+      std::vector<long double> actual;
+      for (int repeat = 0; repeat < repeats; ++repeat)
+      {
+        actual = aiSnake.computeInputs();
+      }
+      bitboardTime += std::chrono::steady_clock::now() - middleTime;
+      legacyTime += middleTime - startTime;
+      if (actual != expected)
+      {
+        std::fprintf(stderr, "Feature mismatch on %dx%d board at state %d\n", gridCells, gridCells, state);
+        return 1;
+      }
+    }
+    auto legacyNs = std::chrono::duration<double, std::nano>(legacyTime).count() / (statesCount * repeats);
+    auto bitboardNs = std::chrono::duration<double, std::nano>(bitboardTime).count() / (statesCount * repeats);
+    std::printf("%4dx%-4d %14.1f %14.1f %9.1fx\n", gridCells, gridCells, legacyNs, bitboardNs, legacyNs / bitboardNs);
+  }
+  return 0;
+};
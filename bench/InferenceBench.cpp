@@ -0,0 +1,99 @@
+#include <Bench.hpp>
+#include <NeuralNetwork.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace zeuron;
+using namespace snake;
+
+/*
+ * Per decision latency of the long double NeuralNetwork against the float
+ * and double InferenceNetwork and the compile-time SnakeNetwork, plus the
+ * largest output difference from the long double reference
+ */
+static const auto inputsCount = 1024;
+static const auto repeats = 50;
+
+template <typename F>
+static double nanosecondsPerDecision(F &&decide)
+{
+  auto startTime = std::chrono::steady_clock::now();
+  for (int repeat = 0; repeat < repeats; ++repeat)
+  {
+    for (int inputIndex = 0; inputIndex < inputsCount; ++inputIndex)
+    {
+      decide(inputIndex);
+    }
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() /
+         (double(inputsCount) * repeats);
+};
+
+int snake::runInferenceBench()
+{
+  auto network = loadOrCreateAINetwork();
+  InferenceNetwork<float> floatNetwork;
+  InferenceNetwork<double> doubleNetwork;
+  SnakeNetwork snakeNetwork;
+  if (!floatNetwork.load(*network) || !doubleNetwork.load(*network) || !loadSnakeNetwork(*network, snakeNetwork))
+  {
+    std::fprintf(stderr, "Could not convert the network\n");
+    return 1;
+  }
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> valueDistribution(-20.0, 20.0);
+  std::vector<std::vector<long double>> inputs(inputsCount, std::vector<long double>(SnakeNetwork::inputs));
+  std::vector<std::array<float, SnakeNetwork::inputs>> floatInputs(inputsCount);
+  std::vector<std::array<double, SnakeNetwork::inputs>> doubleInputs(inputsCount);
+  std::vector<std::vector<long double>> referenceOutputs(inputsCount);
+  for (int inputIndex = 0; inputIndex < inputsCount; ++inputIndex)
+  {
+    for (unsigned int value = 0; value < SnakeNetwork::inputs; ++value)
+    {
+      inputs[inputIndex][value] = valueDistribution(generator);
+      floatInputs[inputIndex][value] = float(inputs[inputIndex][value]);
+      doubleInputs[inputIndex][value] = double(inputs[inputIndex][value]);
+    }
+    network->feedforward(inputs[inputIndex]);
+    referenceOutputs[inputIndex] = network->getOutputs();
+  }
+  long double floatError = 0, doubleError = 0, snakeError = 0;
+  float floatOutputs[SnakeNetwork::outputs], snakeOutputs[SnakeNetwork::outputs];
+  double doubleOutputs[SnakeNetwork::outputs];
+  auto longDoubleTime = nanosecondsPerDecision([&](const int &inputIndex)
+  {
+    network->feedforward(inputs[inputIndex]);
+  });
+  auto floatTime = nanosecondsPerDecision([&](const int &inputIndex)
+  {
+    floatNetwork.feedforward(floatInputs[inputIndex].data(), floatOutputs);
+  });
+  auto doubleTime = nanosecondsPerDecision([&](const int &inputIndex)
+  {
+    doubleNetwork.feedforward(doubleInputs[inputIndex].data(), doubleOutputs);
+  });
+  auto snakeTime = nanosecondsPerDecision([&](const int &inputIndex)
+  {
+    snakeNetwork.feedforward(floatInputs[inputIndex].data(), snakeOutputs);
+  });
+  for (int inputIndex = 0; inputIndex < inputsCount; ++inputIndex)
+  {
+    floatNetwork.feedforward(floatInputs[inputIndex].data(), floatOutputs);
+    doubleNetwork.feedforward(doubleInputs[inputIndex].data(), doubleOutputs);
+    snakeNetwork.feedforward(floatInputs[inputIndex].data(), snakeOutputs);
+    for (unsigned int output = 0; output < SnakeNetwork::outputs; ++output)
+    {
+      auto reference = referenceOutputs[inputIndex][output];
+      floatError = std::max(floatError, std::abs(reference - floatOutputs[output]));
+      doubleError = std::max(doubleError, std::abs(reference - doubleOutputs[output]));
+      snakeError = std::max(snakeError, std::abs(reference - snakeOutputs[output]));
+    }
+  }
+  std::printf("%-24s %12s %12s\n", "engine", "ns/decision", "max error");
+  std::printf("%-24s %12.1f %12s\n", "NeuralNetwork (long double)", longDoubleTime, "-");
+  std::printf("%-24s %12.1f %12.2Le\n", "InferenceNetwork<double>", doubleTime, doubleError);
+  std::printf("%-24s %12.1f %12.2Le\n", "InferenceNetwork<float>", floatTime, floatError);
+  std::printf("%-24s %12.1f %12.2Le\n", "SnakeNetwork", snakeTime, snakeError);
+  return floatError > 1e-3 || snakeError > 1e-3 ? 1 : 0;
+};
@@ -0,0 +1,135 @@
+#include <Bench.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace snake;
+
+/*
+ * Stress test of Snake::inputs with one producer thread per snake pushing
+ * random turns, as the window thread's key handlers do, while this thread
+ * consumes like the simulation thread. The first pass pops the queues
+ * directly and checks every accepted turn comes out in push order, the
+ * second ticks the snakes and checks no tick turns a snake back on itself.
+ */
+static const auto snakesCount = 4;
+static const auto pushesPerSnake = 1 << 18;
+
+static bool reverses(const Direction &from, const Direction &to)
+{
+  return (from == Direction::Up && to == Direction::Down) || (from == Direction::Down && to == Direction::Up) ||
+         (from == Direction::Left && to == Direction::Right) || (from == Direction::Right && to == Direction::Left);
+};
+
+// Runs one producer per board until it pushed pushesPerSnake turns, calling consume on this thread meanwhile
+template <typename F>
+static double runProducers(std::vector<std::unique_ptr<Board>> &boards, std::vector<std::vector<Direction>> &accepted,
+                           F &&consume)
+{
+  std::atomic<int> producersDone{0};
+  std::vector<std::thread> producers;
+  auto startTime = std::chrono::steady_clock::now();
+  for (int index = 0; index < snakesCount; ++index)
+  {
+    accepted[index].clear();
+    producers.emplace_back([&, index]
+    {
+      Random random(index, 1);
+      auto &inputs = boards[index]->snake->inputs;
+      for (int push = 0; push < pushesPerSnake; ++push)
+      {
+        auto direction = Direction(1 + random.below(4));
+        // Retry rather than drop when full so every turn reaches the consumer
+        while (!inputs.push(direction))
+        {
+          std::this_thread::yield();
+        }
+        accepted[index].push_back(direction);
+      }
+      ++producersDone;
+    });
+  }
+  // One more round after the producers finished drains what they left behind
+  auto finished = false;
+  while (!finished)
+  {
+    finished = producersDone.load() == snakesCount;
+    consume();
+    // Lets producers in on machines with fewer cores than threads
+    std::this_thread::yield();
+  }
+  for (auto &producer : producers)
+  {
+    producer.join();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+};
+
+int snake::runInputBench()
+{
+  // Collisions must end the game here rather than reset the snake inside update
+  auto previousTrainingAI = trainingAI;
+  trainingAI = false;
+  int result = 0;
+  std::vector<std::unique_ptr<Board>> boards;
+  for (int index = 0; index < snakesCount; ++index)
+  {
+    boards.push_back(std::make_unique<Board>(64, 64, false, Random(index)));
+    boards.back()->snake = std::make_shared<Snake>(*boards.back());
+  }
+  std::vector<std::vector<Direction>> accepted(snakesCount);
+  std::vector<std::vector<Direction>> popped(snakesCount);
+  auto popSeconds = runProducers(boards, accepted, [&]
+  {
+    for (int index = 0; index < snakesCount; ++index)
+    {
+      Direction direction;
+      while (boards[index]->snake->inputs.pop(direction))
+      {
+        popped[index].push_back(direction);
+      }
+    }
+  });
+  size_t pops = 0;
+  for (int index = 0; index < snakesCount; ++index)
+  {
+    pops += popped[index].size();
+    if (popped[index] != accepted[index])
+    {
+      std::fprintf(stderr, "Input queue %d popped %zu turns out of order or lost some of %zu\n", index, popped[index].size(),
+                   accepted[index].size());
+      result = 1;
+    }
+  }
+  size_t ticks = 0, reversals = 0;
+  auto tickSeconds = runProducers(boards, accepted, [&]
+  {
+    for (int index = 0; index < snakesCount; ++index)
+    {
+      auto &board = *boards[index];
+      auto &snake = *board.snake;
+      auto previous = snake.direction;
+      snake.update();
+      // A collision can leave the direction anywhere, only moves that went on are checked
+      if (board.gameOver)
+      {
+        board.gameOver = false;
+        snake.reset();
+        continue;
+      }
+      reversals += reverses(previous, snake.direction);
+    }
+    ++ticks;
+  });
+  if (reversals)
+  {
+    std::fprintf(stderr, "%zu ticks turned a snake back on itself\n", reversals);
+    result = 1;
+  }
+  std::printf("%8s %12s %14s %12s %14s\n", "snakes", "pops", "M pops/s", "ticks", "M ticks/s");
+  std::printf("%8d %12zu %14.1f %12zu %14.1f\n", snakesCount, pops, pops / popSeconds / 1e6, ticks * snakesCount,
+              ticks * snakesCount / tickSeconds / 1e6);
+  trainingAI = previousTrainingAI;
+  return result;
+};
@@ -0,0 +1,70 @@
+#include <Bench.hpp>
+#include <Training.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+using namespace snake;
+
+/*
+ * End to end training throughput recorded for --json: simulated board ticks
+ * and trained samples per second of SimulationPool, with its default batch
+ * simulation and batched trainer, across grid sizes and thread counts. Every
+ * configuration starts from createAINetwork(1) rather than snake.nrl, so
+ * runs on different machines compare, and from the same board seed. The
+ * number of ticks shrinks with the grid so each one takes a comparable time.
+ */
+static const auto boardsCount = 256u;
+static const auto boardTicksBudget = 1u << 18;
+
+int snake::runMacroBench()
+{
+  std::printf("%10s %8s %14s %16s\n", "grid", "threads", "ticks/s", "samples/s");
+  auto previousTrainingAI = trainingAI;
+  trainingAI = true;
+  auto previousNetwork = aiNetwork;
+  auto initialNetwork = createAINetwork(1);
+  int result = 0;
+  for (int gridCells : {20, 40, 80})
+  {
+    for (unsigned int threads : {1u, 2u, 4u})
+    {
+      aiNetwork = copyAINetwork(*initialNetwork);
+      TrainingOptions options;
+      options.gridWidth = gridCells;
+      options.gridHeight = gridCells;
+      options.boards = boardsCount;
+      options.threads = threads;
+      options.reportInterval = 0;
+      options.seed = 1;
+      options.ticks = std::max(8u, boardTicksBudget / boardsCount * 400 / unsigned(gridCells * gridCells));
+      std::atomic<bool> stopRequested = false;
+      // SimulationPool reports its seed and totals on std::cout, keep the table clean
+      std::ostringstream poolOutput;
+      auto previousBuffer = std::cout.rdbuf(poolOutput.rdbuf());
+      SimulationPool pool(options);
+      auto startTime = std::chrono::steady_clock::now();
+      pool.run(stopRequested);
+      auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+      std::cout.rdbuf(previousBuffer);
+      if (pool.ticks != options.ticks * boardsCount || pool.samplesTrained < pool.ticks)
+      {
+        std::fprintf(stderr, "Macro run %dx%d with %u threads stopped early\n", gridCells, gridCells, threads);
+        result = 1;
+      }
+      auto ticksPerSecond = pool.ticks / seconds;
+      auto samplesPerSecond = pool.samplesTrained / seconds;
+      char grid[32];
+      std::snprintf(grid, sizeof(grid), "%dx%d", gridCells, gridCells);
+      std::printf("%10s %8u %14.0f %16.0f\n", grid, threads, ticksPerSecond, samplesPerSecond);
+      std::vector<std::pair<std::string, std::string>> parameters{{"grid", grid}, {"threads", std::to_string(threads)},
+                                                                 {"boards", std::to_string(boardsCount)}};
+      recordResult({"macro", "training ticks", "ticks/s", ticksPerSecond, parameters});
+      recordResult({"macro", "training samples", "samples/s", samplesPerSecond, parameters});
+    }
+  }
+  aiNetwork = previousNetwork;
+  trainingAI = previousTrainingAI;
+  return result;
+};
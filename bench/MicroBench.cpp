@@ -0,0 +1,165 @@
+#include <Bench.hpp>
+#include <InferenceNetwork.hpp>
+#include <NeuralNetwork.hpp>
+#include <ByteStream.hpp>
+#include <Tracer.hpp>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+using namespace zeuron;
+using namespace snake;
+
+/*
+ * Per call cost of the hot paths, recorded for --json: Snake::update,
+ * Board::aStar to random targets, Board::setFruitToRandom and the network
+ * features on a board whose snake loops along row 0 without ever colliding
+ * or eating, from 16x16 to 1024x1024 so growth with the grid shows, then NeuralNetwork::feedforward/backpropagate, the float
+ * InferenceNetwork, a snake.nrl round trip through a temporary file and an
+ * idle trace scope.
+ */
+static void report(const std::string &name, const double &nanoseconds, const std::string &grid = "")
+{
+  std::printf("%-38s %10s %12.1f\n", name.c_str(), grid.c_str(), nanoseconds);
+  BenchResult result{"micro", name, "ns/op", nanoseconds, {}};
+  if (!grid.empty())
+  {
+    result.parameters.push_back({"grid", grid});
+  }
+  recordResult(result);
+};
+
+static int runBoardBenches(const int &gridCells)
+{
+  Board board(gridCells, gridCells, true, Random(gridCells));
+  auto &snake = (AISnake &)*board.snake;
+  loopAlongFirstRow(board);
+  char grid[32];
+  std::snprintf(grid, sizeof(grid), "%dx%d", gridCells, gridCells);
+  auto cellsCount = gridCells * gridCells;
+  auto searches = std::max(64, operationsBudget / cellsCount);
+  report("Snake::update", nanosecondsPerCall(1 << 16, [&](const int &)
+  {
+    snake.update();
+  }), grid);
+  Random random(1);
+  std::vector<iPoint2D> targets(searches);
+  for (auto &target : targets)
+  {
+    target = {int(random.below(gridCells)), 1 + int(random.below(gridCells - 1))};
+  }
+  size_t emptyPaths = 0;
+  report("Board::aStar", nanosecondsPerCall(searches, [&](const int &index)
+  {
+    emptyPaths += board.aStar(snake.segments.front(), targets[index]).empty();
+  }), grid);
+  report("Board::setFruitToRandom", nanosecondsPerCall(1 << 16, [&](const int &)
+  {
+    board.setFruitToRandom();
+  }), grid);
+  double featureSum = 0;
+  report("AISnake::computeInputs", nanosecondsPerCall(1 << 14, [&](const int &)
+  {
+    featureSum += snake.computeInputs()[4];
+  }), grid);
+  // The std::find scans grow with length times grid side, keep their total work bounded
+  auto head = snake.segments.front();
+  auto scans = std::max(16, operationsBudget / (cellsCount * 4));
+  report("AISnake::computeDistanceToSnake*", nanosecondsPerCall(scans, [&](const int &)
+  {
+    featureSum += snake.computeDistanceToSnakeUp(head, snake.segments) +
+                  snake.computeDistanceToSnakeDown(head, snake.segments, gridCells) +
+                  snake.computeDistanceToSnakeLeft(head, snake.segments) +
+                  snake.computeDistanceToSnakeRight(head, snake.segments, gridCells);
+  }), grid);
+  if (emptyPaths || snake.segments.size() != size_t(gridCells - 1) || board.gameOver || featureSum <= 0)
+  {
+    std::fprintf(stderr, "Micro board %s left its scripted loop\n", grid);
+    return 1;
+  }
+  return 0;
+};
+
+static int runNetworkBenches()
+{
+  auto network = loadOrCreateAINetwork();
+  InferenceNetwork<float> floatNetwork;
+  if (!floatNetwork.load(*network))
+  {
+    std::fprintf(stderr, "aiNetwork cannot be converted to InferenceNetwork<float>\n");
+    return 1;
+  }
+  Random random(3);
+  std::vector<std::vector<long double>> inputs(256, std::vector<long double>(SampleBatch::inputsCount));
+  std::vector<float> floatInputs;
+  for (auto &input : inputs)
+  {
+    for (auto &value : input)
+    {
+      value = random.uniform() * 40 - 20;
+      floatInputs.push_back(float(value));
+    }
+  }
+  std::vector<long double> expectedOutputs{0, 0, 1, 0};
+  long double outputSum = 0;
+  report("NeuralNetwork::feedforward", nanosecondsPerCall(1 << 12, [&](const int &index)
+  {
+    network->feedforward(inputs[index & 255]);
+    outputSum += network->getOutputs()[0];
+  }));
+  // Timed with the feedforward it needs, minus the feedforward alone
+  auto feedforwardTime = nanosecondsPerCall(1 << 12, [&](const int &index)
+  {
+    network->feedforward(inputs[index & 255]);
+  });
+  auto trainingTime = nanosecondsPerCall(1 << 12, [&](const int &index)
+  {
+    network->feedforward(inputs[index & 255]);
+    network->backpropagate(expectedOutputs);
+  });
+  report("NeuralNetwork::backpropagate", std::max(0.0, trainingTime - feedforwardTime));
+  float floatOutputs[SampleBatch::outputsCount];
+  report("InferenceNetwork<float>::feedforward", nanosecondsPerCall(1 << 16, [&](const int &index)
+  {
+    floatNetwork.feedforward(floatInputs.data() + (index & 255) * SampleBatch::inputsCount, floatOutputs);
+    outputSum += floatOutputs[0];
+  }));
+  auto path = (std::filesystem::temp_directory_path() / "snake_bench.nrl").string();
+  report("snake.nrl save", nanosecondsPerCall(64, [&](const int &)
+  {
+    auto stream = network->serialize();
+    writeBufferToFile(stream.bytes.get(), stream.bytesSize, path);
+  }));
+  size_t loadedLayers = 0;
+  report("snake.nrl load", nanosecondsPerCall(64, [&](const int &)
+  {
+    auto bytesSizePair = readFileToBuffer(path);
+    bs::ByteStream byteStream(bytesSizePair.second, bytesSizePair.first);
+    NeuralNetwork loaded(byteStream);
+    loadedLayers += loaded.layers.size();
+  }));
+  std::filesystem::remove(path);
+  if (loadedLayers != 64 * network->layers.size() || !std::isfinite(double(outputSum)))
+  {
+    std::fprintf(stderr, "snake.nrl round trip lost layers or the network produced non-finite outputs\n");
+    return 1;
+  }
+  return 0;
+};
+
+int snake::runMicroBench()
+{
+  std::printf("%-38s %10s %12s\n", "operation", "grid", "ns/op");
+  int result = 0;
+  for (int gridCells : {16, 20, 64, 256, 1024})
+  {
+    result |= runBoardBenches(gridCells);
+  }
+  result |= runNetworkBenches();
+  // What every traced call site pays when the run is not traced
+  report("SNAKE_TRACE scope, tracing off", nanosecondsPerCall(1 << 20, [](const int &)
+  {
+    SNAKE_TRACE("bench");
+  }));
+  return result;
+};
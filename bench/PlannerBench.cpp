@@ -0,0 +1,82 @@
+#include <Bench.hpp>
+#include <chrono>
+#include <cstdio>
+
+using namespace snake;
+
+/*
+ * Per tick planner cost of Board::aStar against the incremental distance
+ * field. A scripted snake follows the planned path (so it grows and the
+ * field gets repaired around its body) and only optimalPath() is timed.
+ * Every field tick is also checked against an untimed Board::aStar on the
+ * same board: both are shortest paths, so their lengths must match.
+ */
+static const auto ticksCount = 20000;
+
+static Direction directionTowards(const iPoint2D &from, const iPoint2D &to)
+{
+  auto dx = to.x - from.x;
+  auto dy = to.y - from.y;
+  if (dx == 1 || dx < -1)
+  {
+    return Direction::Right;
+  }
+  if (dx == -1 || dx > 1)
+  {
+    return Direction::Left;
+  }
+  return dy == 1 || dy < -1 ? Direction::Down : Direction::Up;
+};
+
+static double nanosecondsPerTick(const int &gridCells, const Planner &planner, size_t &longestSnake, size_t &mismatches)
+{
+  Board board(gridCells, gridCells, true, Random(42));
+  board.setPlanner(planner);
+  auto &snake = *board.snake;
+  std::chrono::steady_clock::duration plannerTime{};
+  for (int tick = 0; tick < ticksCount; ++tick)
+  {
+    auto startTime = std::chrono::steady_clock::now();
+    auto &path = board.optimalPath();
+    plannerTime += std::chrono::steady_clock::now() - startTime;
+    if (path.size() > 1)
+    {
+      snake.direction = directionTowards(path[0], path[1]);
+    }
+    // aStar reuses the workspace that holds path, so path is only read before it
+    if (planner == Planner::DistanceField && path.size() != board.aStar(snake.segments.front(), board.fruit).size())
+    {
+      if (mismatches++ == 0)
+      {
+        std::fprintf(stderr, "Distance field and A* disagree on %dx%d at tick %d\n", gridCells, gridCells, tick);
+      }
+    }
+    snake.update();
+    longestSnake = std::max(longestSnake, snake.segments.size());
+  }
+  return std::chrono::duration<double, std::nano>(plannerTime).count() / ticksCount;
+};
+
+int snake::runPlannerBench()
+{
+  auto previousTrainingAI = trainingAI;
+  trainingAI = true;
+  std::printf("%8s %14s %14s %10s %8s\n", "grid", "A* ns/tick", "field ns/tick", "speedup", "length");
+  int result = 0;
+  for (int gridCells : {20, 40, 80, 160})
+  {
+    size_t aStarLongest = 0, fieldLongest = 0, mismatches = 0;
+    auto aStarTime = nanosecondsPerTick(gridCells, Planner::AStar, aStarLongest, mismatches);
+    auto fieldTime = nanosecondsPerTick(gridCells, Planner::DistanceField, fieldLongest, mismatches);
+    if (mismatches)
+    {
+      std::fprintf(stderr, "%zu of %d distance field paths on %dx%d differ in length from A*\n", mismatches, ticksCount,
+                   gridCells, gridCells);
+      result = 1;
+    }
+    std::printf("%4dx%-4d %14.1f %14.1f %9.1fx %8zu\n", gridCells, gridCells, aStarTime, fieldTime,
+                aStarTime / fieldTime, std::max(aStarLongest, fieldLongest));
+  }
+  trainingAI = previousTrainingAI;
+  return result;
+};
@@ -0,0 +1,89 @@
+#include <Bench.hpp>
+#include <ReplayBuffer.hpp>
+#include <chrono>
+#include <cstdio>
+
+using namespace snake;
+
+/*
+ * Throughput of pushing into a spilling ReplayBuffer, sampling from it and
+ * reading the spill file back, which also checks the file round trips
+ */
+static const auto samplesCount = 1 << 20;
+static const auto batchSize = 256;
+
+int snake::runReplayBench()
+{
+  const char *path = "snake_bench_replay.bin";
+  std::remove(path);
+  std::vector<SampleBatch> batches(samplesCount / batchSize);
+  float inputs[SampleBatch::inputsCount], expectedOutputs[SampleBatch::outputsCount];
+  for (size_t batchIndex = 0; batchIndex < batches.size(); ++batchIndex)
+  {
+    for (int row = 0; row < batchSize; ++row)
+    {
+      auto sampleIndex = batchIndex * batchSize + row;
+      for (unsigned int feature = 0; feature < SampleBatch::inputsCount; ++feature)
+      {
+        inputs[feature] = float((sampleIndex + feature) % 1000);
+      }
+      fromLabel(uint8_t(sampleIndex % (SampleBatch::outputsCount + 1)), expectedOutputs);
+      batches[batchIndex].push(inputs, expectedOutputs);
+    }
+  }
+  int result = 0;
+  double pushSeconds, sampleSeconds;
+  {
+    ReplayBuffer replay(1 << 16);
+    if (!replay.spillTo(path))
+    {
+      std::fprintf(stderr, "Could not open %s\n", path);
+      return 1;
+    }
+    auto startTime = std::chrono::steady_clock::now();
+    for (auto &batch : batches)
+    {
+      replay.push(batch);
+    }
+    pushSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    Random generator(1);
+    SampleBatch sampled;
+    startTime = std::chrono::steady_clock::now();
+    for (size_t batchIndex = 0; batchIndex < batches.size(); ++batchIndex)
+    {
+      sampled.clear();
+      replay.sample(batchSize, generator, sampled);
+    }
+    sampleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  }
+  ReplayFile file;
+  if (!file.openForReading(path) || file.recordsCount != samplesCount)
+  {
+    std::fprintf(stderr, "Spill file did not round trip\n");
+    std::remove(path);
+    return 1;
+  }
+  auto startTime = std::chrono::steady_clock::now();
+  uint8_t label;
+  for (uint64_t index = 0; index < file.recordsCount; ++index)
+  {
+    file.read(index, inputs, label);
+    if (inputs[0] != float(index % 1000) || label != index % (SampleBatch::outputsCount + 1))
+    {
+      result = 1;
+    }
+  }
+  auto readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  file.close();
+  std::remove(path);
+  if (result)
+  {
+    std::fprintf(stderr, "Spill file records differ from the pushed samples\n");
+  }
+  std::printf("%-16s %14s\n", "operation", "samples/s");
+  std::printf("%-16s %14.0f\n", "push + spill", samplesCount / pushSeconds);
+  std::printf("%-16s %14.0f\n", "uniform sample", samplesCount / sampleSeconds);
+  std::printf("%-16s %14.0f (%.0f MB/s)\n", "file read", samplesCount / readSeconds,
+              samplesCount * double(ReplayFile::recordSize) / readSeconds / 1e6);
+  return result;
+};
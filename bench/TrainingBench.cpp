@@ -0,0 +1,135 @@
+#include <Bench.hpp>
+#include <BatchTrainer.hpp>
+#include <NeuralNetwork.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace zeuron;
+using namespace snake;
+
+/*
+ * Samples per second of one Zeuron backpropagate per sample against
+ * BatchTrainer at several batch sizes, plus a central difference check of
+ * BatchTrainer's gradients
+ */
+static const auto samplesCount = 4096;
+
+static SampleBatch makeSamples(const size_t &count)
+{
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<double> valueDistribution(-20.0, 20.0);
+  std::uniform_int_distribution<int> outputDistribution(0, SampleBatch::outputsCount - 1);
+  SampleBatch samples;
+  std::vector<long double> input(SampleBatch::inputsCount), expectedOutput(SampleBatch::outputsCount);
+  for (size_t row = 0; row < count; ++row)
+  {
+    for (auto &value : input)
+    {
+      value = valueDistribution(generator);
+    }
+    std::fill(expectedOutput.begin(), expectedOutput.end(), 0.0L);
+    expectedOutput[outputDistribution(generator)] = 1;
+    samples.push(input, expectedOutput);
+  }
+  return samples;
+};
+
+static SampleBatch sliceSamples(const SampleBatch &samples, const size_t &first, const size_t &count)
+{
+  SampleBatch slice;
+  slice.inputs.assign(samples.inputs.begin() + first * SampleBatch::inputsCount,
+                      samples.inputs.begin() + (first + count) * SampleBatch::inputsCount);
+  slice.expectedOutputs.assign(samples.expectedOutputs.begin() + first * SampleBatch::outputsCount,
+                               samples.expectedOutputs.begin() + (first + count) * SampleBatch::outputsCount);
+  return slice;
+};
+
+// Largest relative difference between computeGradients and a central difference of error over a few weights
+static double gradientCheck(BatchTrainer &trainer, const SampleBatch &batch)
+{
+  trainer.computeGradients(batch);
+  auto weightGradients = trainer.weightGradients;
+  std::mt19937 generator(7);
+  double worst = 0;
+  for (size_t layerIndex = 0; layerIndex < trainer.network.layers.size(); ++layerIndex)
+  {
+    auto &layer = trainer.network.layers[layerIndex];
+    std::uniform_int_distribution<unsigned int> inputDistribution(0, layer.inputs - 1);
+    std::uniform_int_distribution<unsigned int> outputDistribution(0, layer.outputs - 1);
+    for (int probe = 0; probe < 8; ++probe)
+    {
+      auto index = inputDistribution(generator) * layer.paddedOutputs + outputDistribution(generator);
+      auto weight = layer.weights[index];
+      const double step = 1e-6;
+      layer.weights[index] = weight + step;
+      auto upper = trainer.error(batch);
+      layer.weights[index] = weight - step;
+      auto lower = trainer.error(batch);
+      layer.weights[index] = weight;
+      auto numeric = (upper - lower) / (2 * step);
+      auto analytic = weightGradients[layerIndex][index];
+      worst = std::max(worst, std::abs(numeric - analytic) / std::max(1e-3, std::abs(numeric) + std::abs(analytic)));
+    }
+  }
+  return worst;
+};
+
+int snake::runTrainingBench()
+{
+  auto samples = makeSamples(samplesCount);
+  auto sgdNetwork = loadOrCreateAINetwork();
+  std::vector<long double> input(SampleBatch::inputsCount), expectedOutput(SampleBatch::outputsCount);
+  auto startTime = std::chrono::steady_clock::now();
+  for (size_t row = 0; row < samples.size(); ++row)
+  {
+    std::copy_n(samples.inputs.begin() + row * SampleBatch::inputsCount, SampleBatch::inputsCount, input.begin());
+    std::copy_n(samples.expectedOutputs.begin() + row * SampleBatch::outputsCount, SampleBatch::outputsCount, expectedOutput.begin());
+    sgdNetwork->feedforward(input);
+    sgdNetwork->backpropagate(expectedOutput);
+  }
+  auto sgdRate = samples.size() / std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  std::printf("%-12s %14s %10s\n", "trainer", "samples/s", "speedup");
+  std::printf("%-12s %14.0f %9.2fx\n", "per-sample", sgdRate, 1.0);
+  int result = 0;
+  for (size_t batchSize : {1, 16, 64, 256})
+  {
+    auto network = loadOrCreateAINetwork();
+    BatchTrainer trainer;
+    if (!trainer.load(*network))
+    {
+      std::fprintf(stderr, "Could not convert the network\n");
+      return 1;
+    }
+    std::vector<SampleBatch> batches;
+    for (size_t first = 0; first + batchSize <= samples.size(); first += batchSize)
+    {
+      batches.push_back(sliceSamples(samples, first, batchSize));
+    }
+    startTime = std::chrono::steady_clock::now();
+    for (auto &batch : batches)
+    {
+      trainer.train(batch);
+    }
+    auto rate = batches.size() * batchSize / std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    char name[32];
+    std::snprintf(name, sizeof(name), "batch %zu", batchSize);
+    std::printf("%-12s %14.0f %9.2fx\n", name, rate, rate / sgdRate);
+    if (!trainer.network.store(*network))
+    {
+      std::fprintf(stderr, "Could not store the trained weights\n");
+      result = 1;
+    }
+  }
+  auto network = loadOrCreateAINetwork();
+  BatchTrainer trainer;
+  trainer.load(*network);
+  auto worst = gradientCheck(trainer, sliceSamples(samples, 0, 32));
+  std::printf("gradient check: worst relative error %.2e\n", worst);
+  if (worst > 1e-4)
+  {
+    std::fprintf(stderr, "BatchTrainer gradients do not match the error\n");
+    result = 1;
+  }
+  return result;
+};
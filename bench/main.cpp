@@ -0,0 +1,112 @@
+#include <Bench.hpp>
+#include <Json.hpp>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+
+using namespace snake;
+
+#ifndef SNAKE_VERSION
+#define SNAKE_VERSION "unknown"
+#endif
+
+struct BenchEntry
+{
+  const char *name;
+  int (*run)();
+};
+
+static const BenchEntry benches[] = {
+  {"collision", runCollisionBench},
+  {"planner", runPlannerBench},
+  {"features", runFeatureBench},
+  {"inference", runInferenceBench},
+  {"training", runTrainingBench},
+  {"replay", runReplayBench},
+  {"input", runInputBench},
+  {"batch", runBatchBench},
+  {"micro", runMicroBench},
+  {"macro", runMacroBench}
+};
+
+static std::vector<BenchResult> results;
+
+void snake::recordResult(const BenchResult &result)
+{
+  results.push_back(result);
+};
+
+static bool writeResults(const std::string &path)
+{
+  std::ofstream file(path);
+  file << "{\n  \"version\": " << jsonString(SNAKE_VERSION) << ",\n  \"results\": [";
+  for (size_t index = 0; index < results.size(); ++index)
+  {
+    auto &result = results[index];
+    file << (index ? ",\n" : "\n") << "    {\"bench\": " << jsonString(result.bench) << ", \"name\": " << jsonString(result.name)
+         << ", \"unit\": " << jsonString(result.unit) << ", \"value\": " << jsonNumber(result.value);
+    for (auto &[key, parameter] : result.parameters)
+    {
+      file << ", " << jsonString(key) << ": " << jsonString(parameter);
+    }
+    file << "}";
+  }
+  file << "\n  ]\n}\n";
+  return bool(file);
+};
+
+/*
+ * Runs every benchmark, or only the ones named on the command line. With
+ * --json PATH the results recorded by the benchmarks are also written there.
+ */
+int main(int argc, char **argv)
+{
+  std::string jsonPath;
+  std::vector<std::string> selectedNames;
+  for (int argIndex = 1; argIndex < argc; ++argIndex)
+  {
+    if (std::strcmp(argv[argIndex], "--json") == 0 && argIndex + 1 < argc)
+    {
+      jsonPath = argv[++argIndex];
+      continue;
+    }
+    auto known = false;
+    for (auto &bench : benches)
+    {
+      known = known || std::strcmp(argv[argIndex], bench.name) == 0;
+    }
+    if (!known)
+    {
+      std::fprintf(stderr, "Unknown benchmark: %s\nUsage: snake_bench [--json PATH] [name...], names:", argv[argIndex]);
+      for (auto &bench : benches)
+      {
+        std::fprintf(stderr, " %s", bench.name);
+      }
+      std::fprintf(stderr, "\n");
+      return 1;
+    }
+    selectedNames.push_back(argv[argIndex]);
+  }
+  int result = 0;
+  for (auto &bench : benches)
+  {
+    bool selected = selectedNames.empty();
+    for (auto &name : selectedNames)
+    {
+      selected = selected || name == bench.name;
+    }
+    if (!selected)
+    {
+      continue;
+    }
+    std::printf("== %s\n", bench.name);
+    std::fflush(stdout);
+    result |= bench.run();
+  }
+  if (!jsonPath.empty() && !writeResults(jsonPath))
+  {
+    std::fprintf(stderr, "Could not write %s\n", jsonPath.c_str());
+    result = 1;
+  }
+  return result;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <Snake.hpp>
+#include <InferenceNetwork.hpp>
+namespace snake
+{
+	/*
+	 * Mini-batch trainer over a double copy of a zeuron::NeuralNetwork.
+	 * A batch is pushed through each layer as one (rows x inputs) * (inputs x
+	 * outputs) product and the gradients of every row are accumulated before a
+	 * single weight update, instead of a feedforward/backpropagate pair per
+	 * sample. The update is the sum of the per-row gradients, so one batch of K
+	 * rows moves the weights about as far as K per-sample steps did.
+	 */
+	struct BatchTrainer
+	{
+		InferenceNetwork<double> network;
+		double learningRate = 0.01;
+		size_t rows = 0;
+		std::vector<double> input;
+		// Per layer (rows x paddedOutputs) pre-activation sums and activations of the last batch
+		std::vector<std::vector<double>> sums;
+		std::vector<std::vector<double>> activations;
+		std::vector<double> deltas;
+		std::vector<double> previousDeltas;
+		// Per layer gradients in the layout of InferenceNetwork::Layer::weights and biases
+		std::vector<std::vector<double>> weightGradients;
+		std::vector<std::vector<double>> biasGradients;
+		// Half the summed squared error of the last computeGradients batch, before its update
+		double batchError = 0;
+		// Copies reference's weights, false if the copy does not reproduce reference.feedforward
+		bool load(zeuron::NeuralNetwork &reference);
+		// One batched forward/backward over every row of batch followed by a single update
+		void train(const SampleBatch &batch);
+		// Fills weightGradients and biasGradients for batch without updating the weights
+		void computeGradients(const SampleBatch &batch);
+		void applyGradients();
+		// Half the summed squared error over batch, the quantity train descends
+		double error(const SampleBatch &batch);
+		void forward(const SampleBatch &batch);
+	};
+	// One Zeuron feedforward/backpropagate per row, the fallback when BatchTrainer cannot load a network
+	void backpropagateSamples(zeuron::NeuralNetwork &network, const SampleBatch &samples);
+}
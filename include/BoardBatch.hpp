@@ -0,0 +1,69 @@
+#pragma once
+#include <Snake.hpp>
+namespace snake
+{
+	/*
+	 * Many boards of one grid size stored as structure-of-arrays: per board
+	 * heads, directions, fruit, scores and ring-buffer bodies sit in parallel
+	 * arrays, and each board owns a fixed stride of the shared body, bitboard
+	 * and free-cell arrays. step advances every board by the rules of
+	 * Snake::update while training (a collision resets the snake and its
+	 * score), first computing all next heads in one branch-free pass over the
+	 * arrays and then applying the moves board by board.
+	 * Fruit placement draws from each board's Random through the same free-cell
+	 * index as OccupancyGrid, so board b follows exactly the trajectory a Board
+	 * seeded with randoms[b] and given the same turns would.
+	 */
+	struct BoardBatch
+	{
+		int gridWidth;
+		int gridHeight;
+		int cellsCount;
+		size_t count;
+		// Strides of one board in bodies, words/columnWords and freeCells/freeSlots
+		size_t ringCapacity;
+		size_t wordsPerBoard;
+		std::vector<int> headX;
+		std::vector<int> headY;
+		std::vector<int> nextX;
+		std::vector<int> nextY;
+		std::vector<Direction> directions;
+		std::vector<int> fruitX;
+		std::vector<int> fruitY;
+		std::vector<int> scores;
+		// Ring slot of the head and segment count of each body
+		std::vector<uint32_t> bodyFirst;
+		std::vector<uint32_t> bodyLength;
+		std::vector<SegmentRing::Cell> bodies;
+		// Row-major and transposed bitboards laid out like OccupancyGrid
+		std::vector<uint64_t> words;
+		std::vector<uint64_t> columnWords;
+		std::vector<uint32_t> freeCounts;
+		std::vector<uint32_t> freeCells;
+		std::vector<uint32_t> freeSlots;
+		std::vector<Random> randoms;
+		// Shared by expectedDirection and snapshot, a batch is stepped by one thread at a time
+		PathfindingWorkspace pathfinding;
+		// Board b draws its fruit from randoms[b]
+		BoardBatch(const int &gridWidth, const int &gridHeight, const std::vector<Random> &randoms);
+		void step();
+		// Takes effect on the next step unless direction is the current one or its reverse, like a queued key press
+		void turn(const size_t &board, const Direction &direction);
+		void reset(const size_t &board);
+		iPoint2D segment(const size_t &board, const size_t &index) const;
+		bool occupied(const size_t &board, const iPoint2D &cell) const;
+		// The 13 network inputs in the order of AISnake::computeInputs
+		void computeInputs(const size_t &board, float *inputs) const;
+		// Move the A* teacher expects from board, see snake::expectedDirection
+		int expectedDirection(const size_t &board);
+		// Copies board into what GameBoard::render draws
+		void snapshot(const size_t &board, BoardSnapshot &snapshot);
+	private:
+		void pushFront(const size_t &board, const int &x, const int &y);
+		void popBack(const size_t &board);
+		void set(const size_t &board, const int &index);
+		void unset(const size_t &board, const int &index);
+		void clearOccupancy(const size_t &board);
+		void setFruitToRandom(const size_t &board);
+	};
+}
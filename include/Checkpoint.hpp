@@ -0,0 +1,71 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+namespace snake
+{
+	struct CheckpointOptions
+	{
+		std::string directory = "checkpoints";
+		// Newest checkpoints kept, older ones are deleted after each write
+		unsigned int keep = 5;
+		// Seconds between background checkpoints, 0 only checkpoints on saveAINetwork
+		double intervalSeconds = 60;
+	};
+	extern CheckpointOptions checkpointOptions;
+	/*
+	 * Replaces path with size bytes of data so that a crash at any point
+	 * leaves either the old or the new file: the bytes go to path + ".tmp",
+	 * which is flushed to disk and then renamed over path.
+	 */
+	bool writeFileAtomically(const std::string &path, const char *data, const size_t &size);
+	/*
+	 * Checkpoint file: a 32 byte header (magic, sequence, payload size, FNV-1a
+	 * checksum of the preceding header bytes and the payload) followed by a
+	 * serialised zeuron::NeuralNetwork.
+	 * Named snake-<sequence>.ckpt, a higher sequence is newer.
+	 */
+	struct Checkpoint
+	{
+		static constexpr char magic[8] = {'S', 'N', 'K', 'C', 'K', 'P', 'T', '1'};
+		static constexpr size_t headerSize = 32;
+		std::string path;
+		uint64_t sequence = 0;
+		uint64_t payloadSize = 0;
+		uint64_t checksum = 0;
+		// Reads the header only, false if path is not a checkpoint
+		bool readHeader(const std::string &path);
+		// Reads and verifies the payload, false when it is truncated or its checksum does not match
+		bool readPayload(std::shared_ptr<char> &payload) const;
+	};
+	// FNV-1a of data, pass a previous result as hash to continue it over more bytes
+	uint64_t checkpointChecksum(const char *data, const size_t &size, const uint64_t &hash = 14695981039346656037ull);
+	// Checkpoints in directory with a readable header, newest first
+	std::vector<Checkpoint> listCheckpoints(const std::string &directory);
+	/*
+	 * Writes payload as the next checkpoint in checkpointOptions.directory and
+	 * deletes all but the newest checkpointOptions.keep that verify, corrupt
+	 * ones are deleted too. Skipped when the newest checkpoint already holds
+	 * the same bytes.
+	 */
+	bool saveCheckpoint(const char *payload, const size_t &size);
+	// Serialises aiNetwork under aiNetworkMutex, then checkpoints it without holding the lock
+	bool checkpointAINetwork();
+	// Calls checkpointAINetwork every intervalSeconds until destroyed, does nothing when intervalSeconds is 0
+	struct CheckpointThread
+	{
+		CheckpointThread(const double &intervalSeconds);
+		~CheckpointThread();
+	private:
+		double intervalSeconds;
+		std::mutex stopMutex;
+		std::condition_variable stopCondition;
+		bool stopRequested = false;
+		std::thread thread;
+		void run();
+	};
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <Snake.hpp>
+#include <ReplayBuffer.hpp>
+#include <string>
+namespace snake
+{
+	enum class DatasetPolicy
+	{
+		// Follows the A* teacher, taking a random turn with probability randomMoves
+		Teacher,
+		Random
+	};
+	struct DatasetOptions
+	{
+		std::string directory = "dataset";
+		unsigned long long samples = 1000000;
+		unsigned int boards = 64;
+		// 0 uses std::thread::hardware_concurrency
+		unsigned int threads = 0;
+		// Records per shard before a worker starts its next shard
+		unsigned long long shardSamples = 1 << 20;
+		DatasetPolicy policy = DatasetPolicy::Teacher;
+		double randomMoves = 0.1;
+		Planner planner = Planner::AStar;
+		int gridWidth = 20;
+		int gridHeight = 20;
+		// Board i draws its fruit from Random(seed, i), so a dataset is reproducible for a given seed and threads count
+		uint64_t seed = Random::entropySeed();
+	};
+	/*
+	 * Steps options.boards headless boards with options.policy and no network,
+	 * labels every state with AISnake::computeExpectedOutputs and writes the
+	 * samples as ReplayFile shards named shard-<worker>-<index>.bin, after
+	 * deleting any shards already in options.directory. Each worker owns its
+	 * boards and its shards, so workers never synchronise. Returns false when
+	 * fewer than options.samples samples reached the shards.
+	 */
+	bool generateDataset(const DatasetOptions &options);
+	struct OfflineTrainingOptions
+	{
+		std::string directory = "dataset";
+		unsigned int epochs = 1;
+		unsigned int batchSize = 256;
+		double learningRate = 0.01;
+		// Records read into memory and shuffled at a time, 0 or 1 trains in file order
+		unsigned long long shuffleWindow = 1 << 16;
+		uint64_t seed = Random::entropySeed();
+	};
+	/*
+	 * Trains aiNetwork on every shard in options.directory. Shards are read
+	 * sequentially through a read-only mapping, one shuffle window at a time,
+	 * so a dataset larger than memory streams from disk.
+	 */
+	void trainOffline(const OfflineTrainingOptions &options);
+	// Shard files in directory, sorted by name
+	std::vector<std::string> listDatasetShards(const std::string &directory);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <Snake.hpp>
+#include <WorkStealingPool.hpp>
+#include <atomic>
+#include <functional>
+#include <random>
+namespace snake
+{
+	struct EvolutionOptions
+	{
+		// 0 evolves until interrupted
+		unsigned int generations = 100;
+		// At least 2
+		unsigned int population = 64;
+		// Episodes each genome plays per generation, its fitness is their mean
+		unsigned int episodes = 4;
+		// Best genomes copied unchanged into the next generation
+		unsigned int elites = 4;
+		unsigned int tournamentSize = 3;
+		double crossoverRate = 0.7;
+		// Chance of each weight being perturbed and the standard deviation of the perturbation
+		double mutationRate = 0.05;
+		double mutationStrength = 0.2;
+		// 0 uses std::thread::hardware_concurrency
+		unsigned int threads = 0;
+		int gridWidth = 20;
+		int gridHeight = 20;
+		// Episode e of generation g is played on Random(seed, g * episodes + e) by every genome
+		uint64_t seed = Random::entropySeed();
+	};
+	struct Genome
+	{
+		InferenceNetwork<float> network;
+		double fitness = 0;
+		int bestScore = 0;
+	};
+	/*
+	 * Evolves a population of networks with aiNetwork's topology. Every
+	 * (genome, episode) pair is one task on a WorkStealingPool, played on its
+	 * own headless Board until the snake collides or goes gridWidth *
+	 * gridHeight ticks without eating. Fitness is 1000 per fruit plus the ticks
+	 * survived. All genomes of a generation play from the same board seeds,
+	 * though fruit cells diverge once their snakes move differently, since
+	 * fruit is drawn from the free cells. The champion kept across
+	 * generations replays each generation's episodes before it is compared
+	 * with that generation's best. The next generation keeps the elites and
+	 * fills the rest with tournament-selected parents, per-neuron crossover
+	 * and gaussian mutation.
+	 */
+	struct EvolutionTrainer
+	{
+		EvolutionOptions options;
+		WorkStealingPool pool;
+		std::vector<Genome> population;
+		std::vector<Genome> offspring;
+		// Per task results of the current generation, task = genome * episodes + episode
+		std::vector<double> episodeFitness;
+		std::vector<int> episodeScores;
+		// False when the seed network could not be converted, the trainer is unusable then
+		bool seeded = false;
+		// Genomes are played through a SnakeNetwork when they have its shape
+		bool useSnakeNetwork = false;
+		std::vector<std::unique_ptr<SnakeNetwork>> workerNetworks;
+		// Selection, crossover and mutation draw from this
+		Random generator;
+		unsigned int generation = 0;
+		// Called after each generation with the champion, the best genome on that generation's episodes
+		std::function<void(const Genome &champion)> onGeneration;
+		EvolutionTrainer(const EvolutionOptions &options, zeuron::NeuralNetwork &seed);
+		void evaluate();
+		// Sets genome's fitness and bestScore from the current generation's episodes
+		void rescore(Genome &genome);
+		double playEpisode(const Genome &genome, const unsigned int &worker, const unsigned int &episode, int &score);
+		void breed();
+		void mutate(Genome &genome);
+		void crossover(const Genome &first, const Genome &second, Genome &child);
+		const Genome &select();
+		const Genome &best() const;
+		void run(const std::atomic<bool> &stopRequested);
+	};
+	// Evolves from aiNetwork and writes the best genome back into it
+	void runEvolution(const EvolutionOptions &options);
+}
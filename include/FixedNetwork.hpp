@@ -0,0 +1,130 @@
+#pragma once
+#include <InferenceNetwork.hpp>
+#include <array>
+#include <tuple>
+#include <utility>
+namespace snake
+{
+	template <Activation A, unsigned int N>
+	struct Dense
+	{
+		static constexpr Activation activation = A;
+		static constexpr unsigned int outputs = N;
+	};
+	/*
+	 * Float network whose shape is fixed at compile time. Every layer has its
+	 * own std::array sized from the template arguments, loop bounds are
+	 * constants the compiler can unroll and vectorize, and the activation of
+	 * each layer is a template argument so it is inlined.
+	 */
+	template <unsigned int Inputs, typename... Layers>
+	struct FixedNetwork
+	{
+		using LayersTuple = std::tuple<Layers...>;
+		static constexpr size_t layersCount = sizeof...(Layers);
+		static constexpr unsigned int inputs = Inputs;
+		static constexpr unsigned int outputs = std::tuple_element_t<layersCount - 1, LayersTuple>::outputs;
+		static constexpr unsigned int maxLayerWidth = std::max({Inputs, (Layers::outputs + 7) / 8 * 8 ...});
+		template <size_t I>
+		static constexpr unsigned int inputsOf()
+		{
+			if constexpr (I == 0)
+				return Inputs;
+			else
+				return std::tuple_element_t<I - 1, LayersTuple>::outputs;
+		}
+		// Outputs are padded to whole 8 float registers, padding weights and biases stay 0
+		static constexpr unsigned int padded(const unsigned int &width)
+		{
+			return (width + 7) / 8 * 8;
+		}
+		template <unsigned int In, unsigned int Out>
+		struct LayerWeights
+		{
+			// weights[input * padded(Out) + output]
+			alignas(32) std::array<float, In * padded(Out)> weights{};
+			alignas(32) std::array<float, padded(Out)> biases{};
+		};
+		template <size_t... I>
+		static auto makeWeights(std::index_sequence<I...>)
+			-> std::tuple<LayerWeights<inputsOf<I>(), std::tuple_element_t<I, LayersTuple>::outputs>...>;
+		decltype(makeWeights(std::index_sequence_for<Layers...>{})) weights;
+
+		// Copies the weights of a converted network, false if its shape or activations differ from this type
+		bool load(const InferenceNetwork<float> &network)
+		{
+			if (network.inputs != Inputs || network.layers.size() != layersCount)
+			{
+				return false;
+			}
+			return loadLayers(network, std::index_sequence_for<Layers...>{});
+		}
+		void feedforward(const float *input, float *output) const
+		{
+			forward(input, output, std::index_sequence_for<Layers...>{});
+		}
+
+	private:
+		template <size_t... I>
+		bool loadLayers(const InferenceNetwork<float> &network, std::index_sequence<I...>)
+		{
+			return (loadLayer<I>(network.layers[I]) && ...);
+		}
+		template <size_t I>
+		bool loadLayer(const typename InferenceNetwork<float>::Layer &source)
+		{
+			using Layer = std::tuple_element_t<I, LayersTuple>;
+			constexpr auto In = inputsOf<I>();
+			constexpr auto Out = Layer::outputs;
+			if (source.inputs != In || source.outputs != Out || source.activation != Layer::activation)
+			{
+				return false;
+			}
+			auto &layer = std::get<I>(weights);
+			for (unsigned int input = 0; input < In; ++input)
+			{
+				for (unsigned int output = 0; output < Out; ++output)
+				{
+					layer.weights[input * padded(Out) + output] = source.weights[input * source.paddedOutputs + output];
+				}
+			}
+			for (unsigned int output = 0; output < Out; ++output)
+			{
+				layer.biases[output] = source.biases[output];
+			}
+			return true;
+		}
+		template <size_t I>
+		void forwardLayer(const float *input, float *output) const
+		{
+			using Layer = std::tuple_element_t<I, LayersTuple>;
+			constexpr auto In = inputsOf<I>();
+			constexpr auto Out = Layer::outputs;
+			constexpr auto PaddedOut = padded(Out);
+			auto &layer = std::get<I>(weights);
+			alignas(32) float sums[PaddedOut];
+			for (unsigned int out = 0; out < PaddedOut; ++out)
+			{
+				sums[out] = layer.biases[out];
+			}
+			for (unsigned int in = 0; in < In; ++in)
+			{
+				auto value = input[in];
+				for (unsigned int out = 0; out < PaddedOut; ++out)
+				{
+					sums[out] += value * layer.weights[in * PaddedOut + out];
+				}
+			}
+			for (unsigned int out = 0; out < Out; ++out)
+			{
+				output[out] = activate<Layer::activation>(sums[out]);
+			}
+		}
+		template <size_t... I>
+		void forward(const float *input, float *output, std::index_sequence<I...>) const
+		{
+			alignas(32) float buffers[2][maxLayerWidth];
+			(forwardLayer<I>(I == 0 ? input : buffers[(I - 1) & 1], I == layersCount - 1 ? output : buffers[I & 1]), ...);
+		}
+	};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+namespace zeuron
+{
+	struct NeuralNetwork;
+}
+namespace snake
+{
+	enum class Activation
+	{
+		HardSigmoid,
+		Tanh,
+		Softplus,
+		BentIdentity
+	};
+	// Activation functions shared by InferenceNetwork and FixedNetwork, tanh and softplus are written around a single exp
+	template <Activation A, typename T>
+	inline T activate(const T &x)
+	{
+		if constexpr (A == Activation::HardSigmoid)
+			return std::clamp(T(0.2) * x + T(0.5), T(0), T(1));
+		else if constexpr (A == Activation::Tanh)
+			return T(1) - T(2) / (std::exp(T(2) * x) + T(1));
+		else if constexpr (A == Activation::Softplus)
+			return x > T(20) ? x : std::log1p(std::exp(x));
+		else
+			return (std::sqrt(x * x + T(1)) - T(1)) / T(2) + x;
+	}
+	/*
+	 * Inference-only copy of a zeuron::NeuralNetwork in float or double.
+	 * Weights are stored input-major with each layer's outputs padded to a
+	 * multiple of 8, so a layer is a sequence of broadcast-multiply-adds over
+	 * whole AVX2 registers, and feedforward only touches stack buffers.
+	 */
+	template <typename T>
+	struct InferenceNetwork
+	{
+		static constexpr unsigned int maxLayerWidth = 32;
+		static constexpr unsigned int lanePadding = 8;
+		struct Layer
+		{
+			Activation activation;
+			unsigned int inputs;
+			unsigned int outputs;
+			unsigned int paddedOutputs;
+			// weights[input * paddedOutputs + output]
+			std::vector<T> weights;
+			std::vector<T> biases;
+		};
+		unsigned int inputs = 0;
+		std::vector<Layer> layers;
+		// Converts the weights of network, false if its shape or activations are not supported
+		bool load(const zeuron::NeuralNetwork &network);
+		// Writes the weights back into network in the layout load reads, false if its shape differs
+		bool store(zeuron::NeuralNetwork &network) const;
+		// Reads inputs values from input and writes the last layer's outputs to outputs
+		void feedforward(const T *input, T *outputs) const;
+		// Compares against reference->feedforward on fixed probe inputs, true if every output is within tolerance
+		bool validate(zeuron::NeuralNetwork &reference, const T &tolerance) const;
+	};
+	// AVX2/FMA layer kernels built in their own translation unit, only called when the CPU supports them
+	void multiplyAccumulateAvx2(const float *weights, const float *biases, const unsigned int &inputs,
+	                            const unsigned int &paddedOutputs, const float *input, float *sums);
+	void multiplyAccumulateAvx2(const double *weights, const double *biases, const unsigned int &inputs,
+	                            const unsigned int &paddedOutputs, const double *input, double *sums);
+	extern template struct InferenceNetwork<float>;
+	extern template struct InferenceNetwork<double>;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+namespace snake
+{
+	// text as a quoted JSON string, escaping quotes, backslashes and control characters
+	std::string jsonString(const std::string &text);
+	// value with 6 significant digits, or null when it is inf or nan, which JSON cannot represent
+	std::string jsonNumber(const double &value);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <cstddef>
+namespace snake
+{
+	/*
+	 * A whole file mapped into memory, read-only or writable. A writable
+	 * mapping can be grown or shrunk with resize, which remaps it, so pointers
+	 * into data do not survive a resize. Growing reserves the new space, so a
+	 * full disk is a failed resize. A failed resize keeps the old size and
+	 * mapping, or leaves data null when even that cannot be restored.
+	 */
+	struct MappedFile
+	{
+		char *data = 0;
+		size_t size = 0;
+		bool writable = false;
+#ifdef _WIN32
+		void *fileHandle = 0;
+		void *mappingHandle = 0;
+#else
+		int descriptor = -1;
+#endif
+		MappedFile() = default;
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+		~MappedFile();
+		// Maps path, creating it when writable and it does not exist
+		bool open(const std::string &path, const bool &writable);
+		bool resize(const size_t &newSize);
+		void flush();
+		void close();
+	private:
+		bool map();
+		void unmap();
+	};
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+namespace snake
+{
+	enum class ProfilePhase
+	{
+		Inputs,
+		Feedforward,
+		Pathfinding,
+		Backpropagate,
+		Update,
+		BatchStep,
+		Render,
+		Count
+	};
+	const char *profilePhaseName(const ProfilePhase &phase);
+	/*
+	 * Per thread duration histograms, one per phase. Buckets split every power
+	 * of two nanoseconds into 4, so a reported percentile is within 25% of the
+	 * true one. Only the owning thread writes its counters, with relaxed
+	 * stores, and readers sum all threads without stopping them.
+	 */
+	struct PhaseHistogram
+	{
+		static constexpr int bucketsCount = 160;
+		std::array<std::atomic<uint64_t>, bucketsCount> buckets{};
+		std::atomic<uint64_t> count{0};
+		std::atomic<uint64_t> totalNanoseconds{0};
+		static int bucketIndex(const uint64_t &nanoseconds);
+		// Midpoint of the durations that fall into bucket
+		static double bucketNanoseconds(const int &bucket);
+		void record(const uint64_t &nanoseconds);
+	};
+	struct PhaseStatistics
+	{
+		uint64_t count = 0;
+		double meanNanoseconds = 0;
+		double p50Nanoseconds = 0;
+		double p99Nanoseconds = 0;
+	};
+	// Records into the calling thread's histograms, registering them on first use
+	void recordPhase(const ProfilePhase &phase, const uint64_t &nanoseconds);
+	// Summed over every thread that ever recorded, since start
+	PhaseStatistics phaseStatistics(const ProfilePhase &phase);
+	// One line per phase that has samples, empty when nothing was recorded
+	std::string profileSummary();
+	// "850ns", "12.3us" or "4.5ms"
+	std::string formatNanoseconds(const double &nanoseconds);
+	struct ProfileScope
+	{
+		ProfilePhase phase;
+		std::chrono::steady_clock::time_point startTime;
+		ProfileScope(const ProfilePhase &phase);
+		~ProfileScope();
+	};
+}
+/*
+ * SNAKE_PROFILE(Phase) times the rest of the enclosing scope as
+ * ProfilePhase::Phase. It compiles to nothing unless SNAKE_PROFILER is defined
+ * (the SNAKE_ENABLE_PROFILER CMake option).
+ */
+#ifdef SNAKE_PROFILER
+#define SNAKE_PROFILE_CONCAT_(a, b) a##b
+#define SNAKE_PROFILE_CONCAT(a, b) SNAKE_PROFILE_CONCAT_(a, b)
+#define SNAKE_PROFILE(phase) snake::ProfileScope SNAKE_PROFILE_CONCAT(profileScope, __LINE__)(snake::ProfilePhase::phase)
+#else
+#define SNAKE_PROFILE(phase) ((void)0)
+#endif
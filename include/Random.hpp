@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <random>
+namespace snake
+{
+	/*
+	 * xoshiro256** seeded through splitmix64. Every (seed, stream) pair gets an
+	 * independent generator, so each board and thread owns its stream and no
+	 * two share state or a lock. Satisfies UniformRandomBitGenerator for use
+	 * with <random> distributions.
+	 */
+	struct Random
+	{
+		using result_type = uint64_t;
+		uint64_t state[4];
+		Random(const uint64_t &seed = 0, const uint64_t &stream = 0)
+		{
+			auto mixed = splitMix(seed) + stream * 0xD1B54A32D192ED03ull;
+			for (auto &word : state)
+			{
+				word = splitMix(mixed);
+				mixed += 0x9E3779B97F4A7C15ull;
+			}
+		}
+		static constexpr result_type min()
+		{
+			return 0;
+		}
+		static constexpr result_type max()
+		{
+			return std::numeric_limits<result_type>::max();
+		}
+		result_type operator()()
+		{
+			auto result = rotateLeft(state[1] * 5, 7) * 9;
+			auto shifted = state[1] << 17;
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= shifted;
+			state[3] = rotateLeft(state[3], 45);
+			return result;
+		}
+		// Uniform in [0, bound) without modulo bias (Lemire's multiply-shift), bound must be positive
+		uint32_t below(const uint32_t &bound)
+		{
+			auto product = uint64_t(uint32_t((*this)() >> 32)) * bound;
+			if (uint32_t(product) < bound)
+			{
+				auto threshold = uint32_t(-bound) % bound;
+				while (uint32_t(product) < threshold)
+				{
+					product = uint64_t(uint32_t((*this)() >> 32)) * bound;
+				}
+			}
+			return uint32_t(product >> 32);
+		}
+		// Uniform in [0, 1) from the top 53 bits
+		double uniform()
+		{
+			return double((*this)() >> 11) * 0x1.0p-53;
+		}
+		// A seed for runs that did not ask for one
+		static uint64_t entropySeed()
+		{
+			std::random_device device;
+			return (uint64_t(device()) << 32) ^ device();
+		}
+	private:
+		static uint64_t splitMix(uint64_t value)
+		{
+			value += 0x9E3779B97F4A7C15ull;
+			value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+			value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+			return value ^ (value >> 31);
+		}
+		static uint64_t rotateLeft(const uint64_t &value, const int &bits)
+		{
+			return (value << bits) | (value >> (64 - bits));
+		}
+	};
+}
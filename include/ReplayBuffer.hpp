@@ -0,0 +1,65 @@
+#pragma once
+#include <Snake.hpp>
+#include <MappedFile.hpp>
+namespace snake
+{
+	// Index of the expected direction in expectedOutputs, or SampleBatch::outputsCount when none is set
+	uint8_t toLabel(const float *expectedOutputs);
+	void fromLabel(const uint8_t &label, float *expectedOutputs);
+	/*
+	 * Append-only sample file: a 32 byte header (magic, inputs per record,
+	 * record size, records count) followed by records of
+	 * SampleBatch::inputsCount native floats and a toLabel byte. Appends go
+	 * through a writable mapping grown in chunks, and the header's count is
+	 * updated on every append, so a writer that dies leaves a readable prefix.
+	 * When the file cannot grow, appends are dropped and counted, the first
+	 * drop and the total at close are reported.
+	 */
+	struct ReplayFile
+	{
+		static constexpr char magic[8] = {'S', 'N', 'K', 'R', 'P', 'L', 'Y', '1'};
+		static constexpr size_t headerSize = 32;
+		static constexpr size_t recordSize = SampleBatch::inputsCount * sizeof(float) + 1;
+		static constexpr size_t growthRecords = 1 << 16;
+		MappedFile file;
+		std::string path;
+		uint64_t recordsCount = 0;
+		// Appends lost because the file could not grow since it was opened
+		uint64_t droppedRecords = 0;
+		~ReplayFile();
+		// Creates path or continues appending to an existing replay file
+		bool openForAppend(const std::string &path);
+		bool openForReading(const std::string &path);
+		void append(const float *inputs, const uint8_t &label);
+		void read(const uint64_t &index, float *inputs, uint8_t &label) const;
+		// Trims the unused tail of the last chunk, reports any dropped appends and unmaps the file
+		void close();
+	};
+	/*
+	 * Fixed-capacity ring of the most recent samples, kept feature-major so
+	 * each feature is one contiguous array, with uniform sampling. With
+	 * spillTo every pushed sample is also appended to a ReplayFile for offline
+	 * replay.
+	 */
+	struct ReplayBuffer
+	{
+		static constexpr size_t bytesPerSample = SampleBatch::inputsCount * sizeof(float) + 1;
+		// About 3.4 GB of features and labels, larger capacities are clamped to this.
+		// Also keeps slots within the 32 bit Random::below that sample draws them with
+		static constexpr size_t maxCapacity = size_t(1) << 26;
+		size_t capacity;
+		size_t count = 0;
+		size_t next = 0;
+		// features[feature * capacity + slot]
+		std::vector<float> features;
+		std::vector<uint8_t> labels;
+		ReplayFile spillFile;
+		bool spilling = false;
+		ReplayBuffer(const size_t &capacity);
+		bool spillTo(const std::string &path);
+		void push(const SampleBatch &batch);
+		// Appends rows drawn uniformly with replacement to batch
+		void sample(const size_t &rows, Random &generator, SampleBatch &batch) const;
+		size_t size() const;
+	};
+}
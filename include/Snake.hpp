@@ -1,8 +1,63 @@
 #pragma once
 #include <anex/modules/fenster/Fenster.hpp>
-#include <deque>
+#include <vector>
+#include <iterator>
+#include <array>
+#include <limits>
+#include <cstdint>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <FixedNetwork.hpp>
+#include <Random.hpp>
 using namespace anex::modules::fenster;
+namespace zeuron
+{
+	struct NeuralNetwork;
+}
+namespace snake
+{
+	// Compile-time copy of the topology built by loadOrCreateAINetwork, keep the two in sync
+	using SnakeNetwork = FixedNetwork<13,
+		Dense<Activation::HardSigmoid, 32>,
+		Dense<Activation::Tanh, 24>,
+		Dense<Activation::Tanh, 16>,
+		Dense<Activation::Softplus, 12>,
+		Dense<Activation::BentIdentity, 8>,
+		Dense<Activation::HardSigmoid, 4>>;
+}
+// Grid of the boards SnakeScene creates and the pixels per cell they are drawn with, set before the window opens
+extern int boardGridWidth;
+extern int boardGridHeight;
+extern int boardCellSize;
+// Snake moves per second in play, SnakeScene steps its boards as fast as it can while training
+extern double boardTickRate;
+// Samples the Train AI scene collects before each BatchTrainer step on aiNetwork
+extern unsigned int boardTrainingBatchSize;
+// Draws the phase timings over SnakeScene, only has something to show when built with SNAKE_PROFILER
+extern bool profilerOverlay;
+extern bool trainingAI;
+extern std::mutex aiNetworkMutex;
+extern std::shared_ptr<zeuron::NeuralNetwork> aiNetwork;
+// Newest of snake.nrl and the valid checkpoints with the path it came from in source, 0 when neither loads
+std::shared_ptr<zeuron::NeuralNetwork> loadAINetwork(std::string &source);
+// loadAINetwork, or a fresh network when nothing loads
+std::shared_ptr<zeuron::NeuralNetwork> loadOrCreateAINetwork();
+// A fresh network with the SnakeNetwork topology and weights drawn from Random(seed), the same for a given seed
+std::shared_ptr<zeuron::NeuralNetwork> createAINetwork(const uint64_t &seed);
+// Checkpoints aiNetwork and replaces snake.nrl with it atomically
+void saveAINetwork();
+// aiNetwork's serialised bytes, copied under aiNetworkMutex
+std::pair<std::shared_ptr<char>, unsigned long> serializeAINetwork();
+std::pair<std::shared_ptr<char>, unsigned long> readFileToBuffer(const std::string& filename);
+void writeBufferToFile(const char* buffer, unsigned long size, const std::string& filename);
+std::shared_ptr<zeuron::NeuralNetwork> copyAINetwork(const zeuron::NeuralNetwork &network);
+// Converts and validates network into a SnakeNetwork, false if it cannot be represented exactly
+bool loadSnakeNetwork(zeuron::NeuralNetwork &network, snake::SnakeNetwork &snakeNetwork);
 namespace snake
 {
 	struct SnakeGame;
@@ -32,6 +87,14 @@ namespace snake
 								 const std::function<void()> &onEnter);
 		void render() override;
 	};
+	// p50/p99 of every profiled phase in the window's top left corner, refreshed twice a second
+	struct ProfilerOverlay : anex::IEntity
+	{
+		std::vector<std::string> lines;
+		std::chrono::steady_clock::time_point nextRefresh;
+		ProfilerOverlay(anex::IGame &game);
+		void render() override;
+	};
 	struct SnakeGame : FensterGame
 	{
 		unsigned int escKeyId = 0;
@@ -44,6 +107,85 @@ namespace snake
 		int y;
 		bool operator==(const iPoint2D &other) const;
 	};
+	/*
+	 * Snake body as a contiguous power-of-two ring of packed 16-bit
+	 * coordinates, head first. Moving is an index decrement and a store, the
+	 * ring only doubles when the snake outgrows it (at most up to the board's
+	 * cell count) and iteration walks at most two runs of memory. A
+	 * coordinate pair rather than a cell index keeps 4096x4096 boards in 32 bits.
+	 */
+	struct SegmentRing
+	{
+		struct Cell
+		{
+			uint16_t x;
+			uint16_t y;
+		};
+		struct Iterator
+		{
+			using iterator_category = std::input_iterator_tag;
+			using value_type = iPoint2D;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const iPoint2D *;
+			using reference = iPoint2D;
+			const SegmentRing *ring;
+			size_t index;
+			iPoint2D operator*() const;
+			Iterator &operator++();
+			bool operator==(const Iterator &other) const;
+			bool operator!=(const Iterator &other) const;
+		};
+		std::vector<Cell> cells;
+		size_t mask;
+		// Slot of the head
+		size_t first = 0;
+		size_t count = 0;
+		SegmentRing(const int &cellsCount);
+		size_t size() const;
+		bool empty() const;
+		iPoint2D front() const;
+		iPoint2D back() const;
+		// index 0 is the head
+		iPoint2D operator[](const size_t &index) const;
+		void push_front(const iPoint2D &point);
+		void pop_back();
+		void clear();
+		Iterator begin() const;
+		Iterator end() const;
+	private:
+		void grow();
+	};
+	// Highest / lowest set bit index in [begin, end) of a bit array, or -1
+	int lastSetBit(const uint64_t *words, const int &begin, const int &end);
+	int firstSetBit(const uint64_t *words, const int &begin, const int &end);
+	/*
+	 * Flat bitboard with one bit per cell, indexed by y * width + x, plus a
+	 * transposed copy indexed by x * height + y so column scans are word scans too
+	 */
+	struct OccupancyGrid
+	{
+		int width;
+		int height;
+		std::vector<uint64_t> words;
+		std::vector<uint64_t> columnWords;
+		// Free cell indices in no particular order, and each cell's slot in freeCells (noSlot while occupied)
+		static constexpr uint32_t noSlot = ~uint32_t(0);
+		std::vector<uint32_t> freeCells;
+		std::vector<uint32_t> freeSlots;
+		OccupancyGrid(const int &width, const int &height);
+		bool test(const iPoint2D &point) const;
+		void set(const iPoint2D &point);
+		void reset(const iPoint2D &point);
+		void clear();
+		int freeCount() const;
+		// O(1), n < freeCount()
+		iPoint2D nthFree(const int &n) const;
+		// Nearest occupied cell before end / from begin along a row or column, -1 if there is none
+		int lastInRow(const int &y, const int &xEnd) const;
+		int firstInRow(const int &y, const int &xBegin) const;
+		int lastInColumn(const int &x, const int &yEnd) const;
+		int firstInColumn(const int &x, const int &yBegin) const;
+	};
 	enum class Direction
 	{
 		None = 0,
@@ -52,16 +194,58 @@ namespace snake
 		Left,
 		Right
 	};
+	// None for None
+	Direction oppositeDirection(const Direction &direction);
+	/*
+	 * Single producer, single consumer ring of requested turns. Key handlers
+	 * push from the window thread and the simulation thread pops once per
+	 * tick, neither takes a lock. A push onto a full queue is dropped.
+	 */
+	struct InputQueue
+	{
+		static constexpr uint32_t capacity = 16;
+		// Producer side
+		bool push(const Direction &direction);
+		// Consumer side
+		bool pop(Direction &direction);
+		void clear();
+	private:
+		std::array<Direction, capacity> items{};
+		alignas(64) std::atomic<uint32_t> head{0};
+		alignas(64) std::atomic<uint32_t> tail{0};
+	};
+	struct Board;
 	struct GameBoard;
-	struct Snake : anex::IEntity
+	struct BoardBatch;
+	struct SimulationPool;
+	// Supervised samples produced by AISnake::activation, stored as contiguous row-major rows
+	struct SampleBatch
 	{
-		GameBoard &gameBoard;
-		std::deque<iPoint2D> segments;
+		static constexpr unsigned int inputsCount = 13;
+		static constexpr unsigned int outputsCount = 4;
+		std::vector<float> inputs;
+		std::vector<float> expectedOutputs;
+		size_t size() const;
+		bool empty() const;
+		void reserve(const size_t &rows);
+		void clear();
+		void push(const std::vector<long double> &input, const std::vector<long double> &expectedOutput);
+		void push(const float *input, const float *expectedOutput);
+	};
+	struct Snake
+	{
+		Board &board;
+		SegmentRing segments;
+		// Only touched by the thread ticking the board, key handlers go through inputs
 		Direction direction;
-		std::recursive_mutex segmentsMutex;
-		Snake(anex::IGame &game, GameBoard &gameBoard);
-		void render() override;
+		InputQueue inputs;
+		Snake(Board &board);
+		virtual ~Snake() = default;
 		void update();
+		// Body edits go through these so Board::occupancy stays in sync with segments
+		void pushFront(const iPoint2D &head);
+		void popBack();
+		bool occupies(const iPoint2D &point) const;
 		void onUpKey(const bool &pressed);
 		void onDownKey(const bool &pressed);
 		void onLeftKey(const bool &pressed);
@@ -70,6 +254,8 @@ namespace snake
 	};
 	struct PlayerSnake : Snake
 	{
+		anex::IGame &game;
+		GameBoard &gameBoard;
 		unsigned int upKeyId = 0;
 		unsigned int downKeyId = 0;
 		unsigned int leftKeyId = 0;
@@ -80,8 +266,20 @@ namespace snake
 	struct AISnake : Snake
 	{
 		SnakeScene *snakeScenePointer = 0;
-		AISnake(anex::IGame &game, GameBoard &gameBoard);
+		// When samples is set, activation decides with fastNetwork (or network) and defers training to the owner of samples
+		zeuron::NeuralNetwork *network = 0;
+		const InferenceNetwork<float> *fastNetwork = 0;
+		// Play time opponents decide with playNetwork only and do not train
+		std::shared_ptr<const SnakeNetwork> playNetwork;
+		SampleBatch *samples = 0;
+		AISnake(Board &board);
 		void activation();
+		std::vector<long double> computeInputs();
+		// Up, down, left and right distances to the body in one pass over board.occupancy, same values as computeDistanceToSnake*
+		void computeDistancesToSnake(const iPoint2D &head, long double (&distances)[4]) const;
+		// Reads the 4 output neurons (up, down, left, right)
+		void applyOutputs(const long double *outputs);
+		std::vector<long double> computeExpectedOutputs(const iPoint2D &head);
 		bool isCollisionAhead(const iPoint2D& head, Direction direction);
 		// Function to compute distances to walls
 		long double computeDistanceToWallUp(const iPoint2D& head, const int &gridHeight);
@@ -89,10 +287,10 @@ namespace snake
 		long double computeDistanceToWallLeft(const iPoint2D& head, const int &gridWidth);
 		long double computeDistanceToWallRight(const iPoint2D& head, const int &gridWidth);
 		// Function to compute distances to snake segments
-		long double computeDistanceToSnakeUp(const iPoint2D& head, const std::deque<iPoint2D>& segments);
-		long double computeDistanceToSnakeDown(const iPoint2D& head, const std::deque<iPoint2D>& segments, const int &gridHeight);
-		long double computeDistanceToSnakeLeft(const iPoint2D& head, const std::deque<iPoint2D>& segments);
-		long double computeDistanceToSnakeRight(const iPoint2D& head, const std::deque<iPoint2D>& segments, const int &gridWidth);
+		long double computeDistanceToSnakeUp(const iPoint2D& head, const SegmentRing& segments);
+		long double computeDistanceToSnakeDown(const iPoint2D& head, const SegmentRing& segments, const int &gridHeight);
+		long double computeDistanceToSnakeLeft(const iPoint2D& head, const SegmentRing& segments);
+		long double computeDistanceToSnakeRight(const iPoint2D& head, const SegmentRing& segments, const int &gridWidth);
 		// Function to compute relative position of the fruit
 		long double computeRelativeFruitX(const iPoint2D& head, const iPoint2D& fruit, const int &gridWidth);
 		long double computeRelativeFruitY(const iPoint2D& head, const iPoint2D& fruit, const int &gridHeight);
@@ -100,23 +298,135 @@ namespace snake
 		long double computeDirectionX(const Direction &direction);
 		long double computeDirectionY(const Direction &direction);
 		// Function to compute length of the snake
-		long double computeSnakeLength(const std::deque<iPoint2D>& segments);
+		long double computeSnakeLength(const SegmentRing& segments);
 	};
-	// Hash function for Point to use in unordered_map
-	struct iPointHash2D {
-		size_t operator()(const iPoint2D& p) const;
+	/*
+	 * Scratch buffers for Board::aStar, indexed by y * gridWidth + x and reused
+	 * across calls. A cell's gCost/parent are only valid when its visited stamp
+	 * equals the current search stamp, so nothing is cleared between searches.
+	 */
+	struct PathfindingWorkspace
+	{
+		unsigned int stamp = 0;
+		std::vector<unsigned int> visited;
+		std::vector<unsigned int> closed;
+		std::vector<int> gCost;
+		std::vector<int> parent;
+		// Open list as a ring of buckets keyed by fCost, neighbours are never more than 2 above the current fCost.
+		// The buckets and path grow to the largest search seen instead of being reserved for every cell
+		std::array<std::vector<int>, 3> buckets;
+		std::vector<iPoint2D> path;
+		PathfindingWorkspace(const int &cellsCount);
 	};
-	// Node structure for A* priority queue
-	struct Node {
-		iPoint2D point;
-		int gCost; // Cost from start to this point
-		int hCost; // Heuristic cost to target
-		int fCost() const; // Total cost
-
-		// Compare Nodes for priority queue (min-heap)
-		bool operator<(const Node& other) const;
+	// A* over a wrapping grid whose occupied cells are set in words (y * gridWidth + x), returns a view of workspace.path
+	const std::vector<iPoint2D> &findPath(PathfindingWorkspace &workspace, const uint64_t *words, const int &gridWidth,
+	                                      const int &gridHeight, const iPoint2D &start, const iPoint2D &target);
+	// Turn requested by the 4 output neurons (up, down, left, right), None when no output is close enough to 1
+	Direction outputsDirection(const long double *outputs);
+	// Index (up, down, left, right) of the move the A* teacher picks along path from head, -1 when path is empty
+	int expectedDirection(const std::vector<iPoint2D> &path, const iPoint2D &head, const iPoint2D &fruit,
+	                      const int &gridWidth, const int &gridHeight);
+	/*
+	 * BFS distances from root to every free cell of the wrapping grid, repaired
+	 * locally when a single cell is blocked or freed instead of being rebuilt.
+	 * Occupied and unreachable cells hold unreachable.
+	 */
+	struct DistanceField
+	{
+		static constexpr int unreachable = std::numeric_limits<int>::max();
+		int width;
+		int height;
+		iPoint2D root{0, 0};
+		// Set when the field no longer matches the board and needs a rebuild
+		bool dirty = true;
+		std::vector<int> distance;
+		std::vector<int> queue;
+		std::vector<int> seeds;
+		std::vector<int> affected;
+		std::vector<unsigned int> affectedMark;
+		unsigned int affectedStamp = 0;
+		DistanceField(const int &width, const int &height);
+		void rebuild(const OccupancyGrid &occupancy, const iPoint2D &root);
+		void block(const OccupancyGrid &occupancy, const iPoint2D &cell);
+		void unblock(const OccupancyGrid &occupancy, const iPoint2D &cell);
+		int at(const iPoint2D &cell) const;
+	private:
+		// Left, down, right, up with wrap-around, matching the A* direction order
+		void neighborIndices(const int &index, int (&neighbors)[4]) const;
+		void propagate(const OccupancyGrid &occupancy);
 	};
-	struct GameBoard : anex::IEntity
+	enum class Planner
+	{
+		AStar,
+		DistanceField
+	};
+	/*
+	 * Board holds the simulation state of a single game and can be stepped
+	 * without a window, GameBoard adds the on-screen placement and rendering
+	 */
+	struct Board
+	{
+		int gridWidth;
+		int gridHeight;
+		// Cells covered by the snake, kept in sync by Snake::update and Snake::reset
+		OccupancyGrid occupancy;
+		PathfindingWorkspace pathfinding;
+		// Selects how optimalPath is computed, the distance field is only allocated and maintained for Planner::DistanceField
+		Planner planner = Planner::AStar;
+		std::unique_ptr<DistanceField> distanceField;
+		std::shared_ptr<Snake> snake;
+		iPoint2D fruit{0, 0};
+		int score = 0;
+		bool gameOver = false;
+		bool isAI = false;
+		// Bumped whenever the snake body or the fruit changes
+		unsigned long long stateVersion = 0;
+		// stateVersion that pathfinding.path was computed for, ~0 when it holds another search
+		unsigned long long optimalPathVersion = ~0ull;
+		// Fruit placement draws only from this, so a board's trajectory is a function of its seed and its moves
+		Random random;
+		Board(const int &gridWidth, const int &gridHeight, const bool &isAI, const Random &random);
+		virtual ~Board() = default;
+		void tick();
+		void setFruitToRandom();
+		void placeFruit(const iPoint2D &cell);
+		void setPlanner(const Planner &planner);
+		// Returns a view of pathfinding.path, valid until the next call
+		const std::vector<iPoint2D> &aStar(const iPoint2D &start, const iPoint2D &target);
+		// A* path from the snake head to the fruit, searched at most once per board state
+		const std::vector<iPoint2D> &optimalPath();
+	};
+	// What GameBoard::render draws, copied out of a Board after a tick
+	struct BoardSnapshot
+	{
+		std::vector<iPoint2D> segments;
+		std::vector<iPoint2D> path;
+		iPoint2D fruit{0, 0};
+		int score = 0;
+		bool gameOver = false;
+	};
+	/*
+	 * Lock-free hand-off of the newest BoardSnapshot from one writer to one
+	 * reader. Besides the slot each side owns there is a shared middle slot
+	 * that publish and read swap with a single atomic exchange, so the writer
+	 * never waits for a slow renderer and the reader never sees a half written
+	 * snapshot. Slot buffers are reused, a steady game does not allocate.
+	 */
+	struct SnapshotBuffer
+	{
+		std::array<BoardSnapshot, 3> slots;
+		BoardSnapshot &writeSlot();
+		// Makes writeSlot visible to read and hands the writer another slot
+		void publish();
+		// The newest published snapshot, stays valid until the next read
+		const BoardSnapshot &read();
+	private:
+		static constexpr uint8_t freshBit = 4;
+		uint8_t writeIndex = 0;
+		uint8_t readIndex = 1;
+		std::atomic<uint8_t> middle{2};
+	};
+	struct GameBoard : anex::IEntity, Board
 	{
 		enum UseKeys
 		{
@@ -129,11 +439,10 @@ namespace snake
 		int height;
 		int cellSize;
 		UseKeys useKeys;
-		std::shared_ptr<Snake> snake;
-		iPoint2D fruit;
-		int score = 0;
-		bool gameOver = false;
-		bool isAI = false;
+		SnapshotBuffer snapshots;
+		// When set the board draws slot batchSlot of batchView instead of its own state and is not ticked
+		BoardBatch *batchView = 0;
+		size_t batchSlot = 0;
 		GameBoard(anex::IGame &game,
 				  const int &x,
 				  const int &y,
@@ -142,10 +451,32 @@ namespace snake
 				  const int &cellSize,
 				  const UseKeys &useKeys,
 				  const bool &isAI);
+		// Called by the simulation thread after ticking, copies the state render draws
+		void publishSnapshot();
 		void render() override;
-		void setFruitToRandom();
-		std::vector<std::vector<bool>> getGrid() const;
-		std::vector<iPoint2D> aStar(const iPoint2D &start, const iPoint2D &target) const;
+	};
+	/*
+	 * Steps a scene's boards on their own thread with a fixed timestep,
+	 * tickRate ticks per second, or back to back when tickRate is 0, and
+	 * publishes a snapshot per board for the renderer. Unbounded runs publish
+	 * at most about every frame so copying does not slow training down.
+	 * A step function replaces ticking the boards, for boards that view a
+	 * BoardBatch stepped by it.
+	 */
+	struct SimulationThread
+	{
+		std::vector<std::shared_ptr<GameBoard>> boards;
+		double tickRate;
+		std::function<void()> step;
+		SimulationThread(const std::vector<std::shared_ptr<GameBoard>> &boards, const double &tickRate, const std::function<void()> &step = {});
+		~SimulationThread();
+		void stop();
+	private:
+		std::mutex stopMutex;
+		std::condition_variable stopCondition;
+		bool stopRequested = false;
+		std::thread thread;
+		void run();
 	};
 	struct MainMenuScene : anex::IScene
 	{
@@ -176,6 +507,10 @@ namespace snake
 	{
 		bool gameStarted = true;
 		std::vector<std::shared_ptr<GameBoard>> gameBoards;
+		// Steps and trains the boards of a training scene as one BoardBatch
+		std::unique_ptr<SimulationPool> trainingPool;
+		std::unique_ptr<SimulationThread> simulation;
 		SnakeScene(anex::IGame &game, const unsigned int& boardsCount, const bool &player1IsAI = false, const bool &player2IsAI = false);
+		~SnakeScene();
 	};
 }
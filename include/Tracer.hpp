@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+namespace snake
+{
+	/*
+	 * Opt-in timeline of named scopes, written as Chrome trace JSON (opens in
+	 * Perfetto or chrome://tracing). Each thread records complete events into
+	 * its own ring of the most recent ringCapacity events with no locks or
+	 * allocation; the rings are only read when the trace is written. While
+	 * tracing is off a scope costs one acquire load of tracingEnabled, which
+	 * pairs with startTracing's release so the start time is visible.
+	 */
+	struct TraceEvent
+	{
+		// String literal, kept by pointer
+		const char *name;
+		// Nanoseconds since tracing started
+		int64_t start;
+		int64_t end;
+	};
+	static constexpr size_t traceRingCapacity = 1 << 16;
+	extern std::atomic<bool> tracingEnabled;
+	// Records from now on and writes everything recorded to path when the program exits, call before starting threads
+	void startTracing(const std::string &path);
+	// Nanoseconds since tracing started
+	int64_t traceClock();
+	void recordTraceEvent(const char *name, const int64_t &start, const int64_t &end);
+	// Labels the calling thread's track, may be called before tracing starts
+	void setTraceThreadName(const std::string &name);
+	bool writeTrace(const std::string &path);
+	struct TraceScope
+	{
+		const char *name;
+		// -1 when tracing was off as the scope began
+		int64_t start;
+		TraceScope(const char *name);
+		~TraceScope();
+	};
+}
+#define SNAKE_TRACE_CONCAT_(a, b) a##b
+#define SNAKE_TRACE_CONCAT(a, b) SNAKE_TRACE_CONCAT_(a, b)
+// Records the rest of the enclosing scope as a trace event named name, a string literal
+#define SNAKE_TRACE(name) snake::TraceScope SNAKE_TRACE_CONCAT(traceScope, __LINE__)(name)
@@ -0,0 +1,102 @@
+#pragma once
+#include <Snake.hpp>
+#include <BatchTrainer.hpp>
+#include <ReplayBuffer.hpp>
+#include <BoardBatch.hpp>
+#include <atomic>
+#include <thread>
+namespace snake
+{
+	struct TrainingOptions
+	{
+		// Ticks per board, 0 trains until interrupted
+		unsigned long long ticks = 0;
+		// Seconds between progress reports, 0 disables them
+		unsigned int reportInterval = 5;
+		unsigned int boards = 1;
+		// 0 uses std::thread::hardware_concurrency
+		unsigned int threads = 0;
+		// Samples a worker collects before training the shared aiNetwork
+		unsigned int batchSize = 64;
+		// Trains each batch with BatchTrainer instead of one Zeuron backpropagate per sample
+		bool batchedTraining = true;
+		double learningRate = 0.01;
+		// Recent samples kept for replay, 0 trains every sample once
+		size_t replayCapacity = 0;
+		// Every sample pushed to the replay buffer is also appended to this ReplayFile when set
+		std::string replayFile;
+		Planner planner = Planner::AStar;
+		int gridWidth = 20;
+		int gridHeight = 20;
+		// Board i draws its fruit from Random(seed, i)
+		uint64_t seed = Random::entropySeed();
+		// Workers decide moves with a float InferenceNetwork snapshot instead of a long double copy
+		bool fastInference = true;
+		// Each worker steps its boards as one BoardBatch instead of one Board each, only with Planner::AStar
+		bool batchSimulation = true;
+	};
+	/*
+	 * Runs options.boards independent AI boards across a pool of workers.
+	 * Each worker decides moves with its own snapshot of aiNetwork (converted to
+	 * float when options.fastInference and the conversion validates), collects
+	 * the A* samples of its boards and trains aiNetwork with them one batch at
+	 * a time under aiNetworkMutex, refreshing its snapshot afterwards. With
+	 * options.batchedTraining the batch is a single BatchTrainer step whose
+	 * weights are written back into aiNetwork. With options.replayCapacity each
+	 * batch also goes into a ReplayBuffer and is followed by a batch of the
+	 * same size sampled uniformly from it. With options.batchSimulation a
+	 * worker's boards live in a BoardBatch; boards, samples and training then
+	 * follow exactly the sequence the Board path produces for the same seed.
+	 */
+	struct SimulationPool
+	{
+		struct Worker
+		{
+			std::vector<std::shared_ptr<Board>> boards;
+			// Replaces boards when useBatchSimulation
+			std::unique_ptr<BoardBatch> batch;
+			std::shared_ptr<zeuron::NeuralNetwork> network;
+			InferenceNetwork<float> fastNetwork;
+			// Scratch input for network when the float snapshot is not used
+			std::vector<long double> networkInput;
+			SampleBatch samples;
+			std::thread thread;
+		};
+		TrainingOptions options;
+		std::vector<std::unique_ptr<Worker>> workers;
+		bool useFastNetwork = false;
+		bool useBatchTrainer = false;
+		bool useBatchSimulation = false;
+		BatchTrainer trainer;
+		std::unique_ptr<ReplayBuffer> replay;
+		Random replayGenerator;
+		SampleBatch replaySamples;
+		std::atomic<unsigned long long> ticks = 0;
+		std::atomic<unsigned long long> samplesTrained = 0;
+		std::atomic<int> bestScore = 0;
+		std::atomic<unsigned int> finishedWorkers = 0;
+		SimulationPool(const TrainingOptions &options);
+		void run(const std::atomic<bool> &stopRequested);
+		void workerLoop(Worker &worker, const std::atomic<bool> &stopRequested);
+		void batchWorkerLoop(Worker &worker, const std::atomic<bool> &stopRequested);
+		// One tick of worker's BoardBatch: every board decides and records its sample, then all boards move
+		void stepBatch(Worker &worker);
+		void trainBatch(Worker &worker);
+		// Trains aiNetwork on samples, the caller holds aiNetworkMutex
+		void trainSamples(const SampleBatch &samples);
+	};
+	// Sets stopRequested on SIGINT/SIGTERM while alive, restoring the previous handlers afterwards
+	struct StopSignalScope
+	{
+		static std::atomic<bool> stopRequested;
+		void (*previousIntHandler)(int);
+		void (*previousTermHandler)(int);
+		StopSignalScope();
+		~StopSignalScope();
+	};
+	/*
+	 * Trains without a window or visualizer until options.ticks is reached or
+	 * SIGINT/SIGTERM is received
+	 */
+	void runHeadlessTraining(const TrainingOptions &options);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace snake
+{
+	/*
+	 * Persistent threads that run batches of indexed tasks. run deals the
+	 * indices out as one contiguous block per worker deque; a worker pops from
+	 * the back of its own deque and, once it is empty, steals from the front of
+	 * the others, so uneven tasks rebalance without a shared queue.
+	 */
+	struct WorkStealingPool
+	{
+		using Job = std::function<void(const size_t &task, const unsigned int &worker)>;
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<size_t> tasks;
+		};
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> threads;
+		Job job;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		unsigned long long generation = 0;
+		unsigned int busyWorkers = 0;
+		bool stopping = false;
+		// 0 uses std::thread::hardware_concurrency
+		WorkStealingPool(const unsigned int &threadsCount);
+		~WorkStealingPool();
+		unsigned int size() const;
+		// Runs job for every task in [0, tasksCount) and returns once all of them have finished
+		void run(const size_t &tasksCount, const Job &job);
+	private:
+		void workerLoop(const unsigned int workerIndex);
+		bool nextTask(const unsigned int &workerIndex, size_t &task);
+	};
+}
@@ -0,0 +1,218 @@
+#include <BatchTrainer.hpp>
+#include <NeuralNetwork.hpp>
+
+using namespace zeuron;
+using namespace snake;
+
+// Derivative of activation at sum, given output = activation(sum)
+static double activationDerivative(const Activation &activation, const double &sum, const double &output)
+{
+  switch (activation)
+  {
+    case Activation::HardSigmoid: return sum > -2.5 && sum < 2.5 ? 0.2 : 0.0;
+    case Activation::Tanh: return 1.0 - output * output;
+    case Activation::Softplus: return 1.0 / (1.0 + std::exp(-sum));
+    case Activation::BentIdentity: return sum / (2.0 * std::sqrt(sum * sum + 1.0)) + 1.0;
+  }
+  return 1.0;
+};
+
+static double applyActivation(const Activation &activation, const double &x)
+{
+  switch (activation)
+  {
+    case Activation::HardSigmoid: return activate<Activation::HardSigmoid>(x);
+    case Activation::Tanh: return activate<Activation::Tanh>(x);
+    case Activation::Softplus: return activate<Activation::Softplus>(x);
+    case Activation::BentIdentity: return activate<Activation::BentIdentity>(x);
+  }
+  return x;
+};
+
+bool BatchTrainer::load(NeuralNetwork &reference)
+{
+  if (!network.load(reference) || !network.validate(reference, 1e-9) || network.inputs != SampleBatch::inputsCount ||
+      network.layers.back().outputs != SampleBatch::outputsCount)
+  {
+    return false;
+  }
+  sums.resize(network.layers.size());
+  activations.resize(network.layers.size());
+  weightGradients.resize(network.layers.size());
+  biasGradients.resize(network.layers.size());
+  return true;
+};
+
+void BatchTrainer::train(const SampleBatch &batch)
+{
+  computeGradients(batch);
+  applyGradients();
+};
+
+/*
+ * sums[row] = biases + previous[row] * weights for every row, the layer's
+ * weights stay in cache while all rows of the batch stream through them.
+ */
+void BatchTrainer::forward(const SampleBatch &batch)
+{
+  rows = batch.size();
+  input.assign(batch.inputs.begin(), batch.inputs.end());
+  auto previous = input.data();
+  size_t previousStride = network.inputs;
+  for (size_t layerIndex = 0; layerIndex < network.layers.size(); ++layerIndex)
+  {
+    auto &layer = network.layers[layerIndex];
+    auto paddedOutputs = layer.paddedOutputs;
+    auto &layerSums = sums[layerIndex];
+    auto &layerActivations = activations[layerIndex];
+    layerSums.resize(rows * paddedOutputs);
+    layerActivations.resize(rows * paddedOutputs);
+    for (size_t row = 0; row < rows; ++row)
+    {
+      auto rowSums = layerSums.data() + row * paddedOutputs;
+      auto rowInput = previous + row * previousStride;
+      std::copy(layer.biases.begin(), layer.biases.end(), rowSums);
+      for (unsigned int inputIndex = 0; inputIndex < layer.inputs; ++inputIndex)
+      {
+        auto value = rowInput[inputIndex];
+        auto weights = layer.weights.data() + inputIndex * paddedOutputs;
+        for (unsigned int output = 0; output < paddedOutputs; ++output)
+        {
+          rowSums[output] += value * weights[output];
+        }
+      }
+      auto rowActivations = layerActivations.data() + row * paddedOutputs;
+      for (unsigned int output = 0; output < paddedOutputs; ++output)
+      {
+        rowActivations[output] = output < layer.outputs ? applyActivation(layer.activation, rowSums[output]) : 0.0;
+      }
+    }
+    previous = layerActivations.data();
+    previousStride = paddedOutputs;
+  }
+};
+
+void BatchTrainer::computeGradients(const SampleBatch &batch)
+{
+  forward(batch);
+  auto lastIndex = network.layers.size() - 1;
+  {
+    auto &layer = network.layers[lastIndex];
+    auto paddedOutputs = layer.paddedOutputs;
+    deltas.assign(rows * paddedOutputs, 0.0);
+    batchError = 0;
+    for (size_t row = 0; row < rows; ++row)
+    {
+      for (unsigned int output = 0; output < layer.outputs; ++output)
+      {
+        auto index = row * paddedOutputs + output;
+        auto activation = activations[lastIndex][index];
+        auto difference = activation - batch.expectedOutputs[row * SampleBatch::outputsCount + output];
+        batchError += difference * difference / 2;
+        deltas[index] = difference * activationDerivative(layer.activation, sums[lastIndex][index], activation);
+      }
+    }
+  }
+  for (size_t layerIndex = lastIndex + 1; layerIndex-- > 0;)
+  {
+    auto &layer = network.layers[layerIndex];
+    auto paddedOutputs = layer.paddedOutputs;
+    auto previous = layerIndex ? activations[layerIndex - 1].data() : input.data();
+    size_t previousStride = layerIndex ? network.layers[layerIndex - 1].paddedOutputs : network.inputs;
+    auto &gradients = weightGradients[layerIndex];
+    auto &biases = biasGradients[layerIndex];
+    gradients.assign(layer.inputs * paddedOutputs, 0.0);
+    biases.assign(paddedOutputs, 0.0);
+    // gradients = previous^T * deltas, biases = column sums of deltas
+    for (size_t row = 0; row < rows; ++row)
+    {
+      auto rowDeltas = deltas.data() + row * paddedOutputs;
+      auto rowInput = previous + row * previousStride;
+      for (unsigned int inputIndex = 0; inputIndex < layer.inputs; ++inputIndex)
+      {
+        auto value = rowInput[inputIndex];
+        auto rowGradients = gradients.data() + inputIndex * paddedOutputs;
+        for (unsigned int output = 0; output < paddedOutputs; ++output)
+        {
+          rowGradients[output] += value * rowDeltas[output];
+        }
+      }
+      for (unsigned int output = 0; output < paddedOutputs; ++output)
+      {
+        biases[output] += rowDeltas[output];
+      }
+    }
+    if (!layerIndex)
+    {
+      break;
+    }
+    // previousDeltas = (deltas * weights^T) . activation'(previous sums)
+    auto &previousLayer = network.layers[layerIndex - 1];
+    previousDeltas.assign(rows * previousStride, 0.0);
+    for (size_t row = 0; row < rows; ++row)
+    {
+      auto rowDeltas = deltas.data() + row * paddedOutputs;
+      for (unsigned int inputIndex = 0; inputIndex < layer.inputs; ++inputIndex)
+      {
+        auto weights = layer.weights.data() + inputIndex * paddedOutputs;
+        double sum = 0;
+        for (unsigned int output = 0; output < paddedOutputs; ++output)
+        {
+          sum += rowDeltas[output] * weights[output];
+        }
+        auto index = row * previousStride + inputIndex;
+        previousDeltas[index] = sum * activationDerivative(previousLayer.activation, sums[layerIndex - 1][index],
+                                                           activations[layerIndex - 1][index]);
+      }
+    }
+    deltas.swap(previousDeltas);
+  }
+};
+
+void BatchTrainer::applyGradients()
+{
+  for (size_t layerIndex = 0; layerIndex < network.layers.size(); ++layerIndex)
+  {
+    auto &layer = network.layers[layerIndex];
+    auto &gradients = weightGradients[layerIndex];
+    for (size_t index = 0; index < gradients.size(); ++index)
+    {
+      layer.weights[index] -= learningRate * gradients[index];
+    }
+    for (unsigned int output = 0; output < layer.outputs; ++output)
+    {
+      layer.biases[output] -= learningRate * biasGradients[layerIndex][output];
+    }
+  }
+};
+
+double BatchTrainer::error(const SampleBatch &batch)
+{
+  forward(batch);
+  auto &last = activations.back();
+  auto paddedOutputs = network.layers.back().paddedOutputs;
+  double sum = 0;
+  for (size_t row = 0; row < rows; ++row)
+  {
+    for (unsigned int output = 0; output < SampleBatch::outputsCount; ++output)
+    {
+      auto difference = last[row * paddedOutputs + output] - batch.expectedOutputs[row * SampleBatch::outputsCount + output];
+      sum += difference * difference;
+    }
+  }
+  return sum / 2;
+};
+
+void snake::backpropagateSamples(NeuralNetwork &network, const SampleBatch &samples)
+{
+  std::vector<long double> inputs(SampleBatch::inputsCount), expectedOutputs(SampleBatch::outputsCount);
+  for (size_t row = 0; row < samples.size(); ++row)
+  {
+    auto rowInputs = samples.inputs.begin() + row * SampleBatch::inputsCount;
+    auto rowExpectedOutputs = samples.expectedOutputs.begin() + row * SampleBatch::outputsCount;
+    std::copy(rowInputs, rowInputs + SampleBatch::inputsCount, inputs.begin());
+    std::copy(rowExpectedOutputs, rowExpectedOutputs + SampleBatch::outputsCount, expectedOutputs.begin());
+    network.feedforward(inputs);
+    network.backpropagate(expectedOutputs);
+  }
+};
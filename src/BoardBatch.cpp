@@ -0,0 +1,244 @@
+#include <BoardBatch.hpp>
+#include <Profiler.hpp>
+#include <bit>
+
+using namespace snake;
+
+BoardBatch::BoardBatch(const int &gridWidth, const int &gridHeight, const std::vector<Random> &randoms):
+  gridWidth(gridWidth),
+  gridHeight(gridHeight),
+  cellsCount(gridWidth * gridHeight),
+  count(randoms.size()),
+  ringCapacity(std::bit_ceil(size_t(gridWidth * gridHeight))),
+  wordsPerBoard((gridWidth * gridHeight + 63) / 64),
+  headX(count),
+  headY(count),
+  nextX(count),
+  nextY(count),
+  directions(count),
+  fruitX(count),
+  fruitY(count),
+  scores(count),
+  bodyFirst(count),
+  bodyLength(count),
+  bodies(count * ringCapacity),
+  words(count * wordsPerBoard),
+  columnWords(count * wordsPerBoard),
+  freeCounts(count),
+  freeCells(count * cellsCount),
+  freeSlots(count * cellsCount),
+  randoms(randoms),
+  pathfinding(gridWidth * gridHeight)
+{
+  // Same start as a Board built for training: a fresh snake, then the first fruit
+  for (size_t board = 0; board < count; ++board)
+  {
+    reset(board);
+    setFruitToRandom(board);
+  }
+};
+
+void BoardBatch::step()
+{
+  SNAKE_PROFILE(BatchStep);
+  // Next heads of every board, branch-free so the compiler can vectorize it
+  for (size_t board = 0; board < count; ++board)
+  {
+    auto direction = directions[board];
+    auto x = headX[board] + (direction == Direction::Right) - (direction == Direction::Left);
+    auto y = headY[board] + (direction == Direction::Down) - (direction == Direction::Up);
+    x += (x < 0) * gridWidth - (x >= gridWidth) * gridWidth;
+    y += (y < 0) * gridHeight - (y >= gridHeight) * gridHeight;
+    nextX[board] = x;
+    nextY[board] = y;
+  }
+  for (size_t board = 0; board < count; ++board)
+  {
+    auto x = nextX[board];
+    auto y = nextY[board];
+    if (occupied(board, {x, y}))
+    {
+      reset(board);
+      scores[board] = 0;
+      continue;
+    }
+    pushFront(board, x, y);
+    if (x == fruitX[board] && y == fruitY[board])
+    {
+      ++scores[board];
+      setFruitToRandom(board);
+    }
+    else
+    {
+      popBack(board);
+    }
+  }
+};
+
+void BoardBatch::turn(const size_t &board, const Direction &direction)
+{
+  auto current = directions[board];
+  if (direction != Direction::None && direction != current && direction != oppositeDirection(current))
+  {
+    directions[board] = direction;
+  }
+};
+
+void BoardBatch::reset(const size_t &board)
+{
+  bodyFirst[board] = 0;
+  bodyLength[board] = 0;
+  clearOccupancy(board);
+  pushFront(board, gridWidth / 2 - 1, gridHeight / 2);
+  pushFront(board, gridWidth / 2, gridHeight / 2);
+  directions[board] = Direction::Right;
+};
+
+iPoint2D BoardBatch::segment(const size_t &board, const size_t &index) const
+{
+  auto &cell = bodies[board * ringCapacity + ((bodyFirst[board] + index) & (ringCapacity - 1))];
+  return {cell.x, cell.y};
+};
+
+bool BoardBatch::occupied(const size_t &board, const iPoint2D &cell) const
+{
+  auto index = cell.y * gridWidth + cell.x;
+  return (words[board * wordsPerBoard + (index >> 6)] >> (index & 63)) & 1;
+};
+
+void BoardBatch::computeInputs(const size_t &board, float *inputs) const
+{
+  SNAKE_PROFILE(Inputs);
+  auto x = headX[board];
+  auto y = headY[board];
+  auto rows = words.data() + board * wordsPerBoard;
+  auto columns = columnWords.data() + board * wordsPerBoard;
+  auto up = lastSetBit(columns, x * gridHeight, x * gridHeight + y);
+  auto down = firstSetBit(columns, x * gridHeight + y + 1, (x + 1) * gridHeight);
+  auto left = lastSetBit(rows, y * gridWidth, y * gridWidth + x);
+  auto right = firstSetBit(rows, y * gridWidth + x + 1, (y + 1) * gridWidth);
+  double fruitDeltaX = fruitX[board] - x;
+  double fruitDeltaY = fruitY[board] - y;
+  if (fruitDeltaX > gridWidth / 2.0) fruitDeltaX -= gridWidth;
+  if (fruitDeltaX < -gridWidth / 2.0) fruitDeltaX += gridWidth;
+  if (fruitDeltaY > gridHeight / 2.0) fruitDeltaY -= gridHeight;
+  if (fruitDeltaY < -gridHeight / 2.0) fruitDeltaY += gridHeight;
+  auto direction = directions[board];
+  inputs[0] = float(y);
+  inputs[1] = float(gridHeight - y - 1);
+  inputs[2] = float(x);
+  inputs[3] = float(gridWidth - x - 1);
+  // Rays that hit nothing report one past the wall, as in AISnake::computeDistancesToSnake
+  inputs[4] = float(up < 0 ? y + 1 : y - (up - x * gridHeight));
+  inputs[5] = float(down < 0 ? gridHeight - y : down - x * gridHeight - y);
+  inputs[6] = float(left < 0 ? x + 1 : x - (left - y * gridWidth));
+  inputs[7] = float(right < 0 ? gridWidth - x : right - y * gridWidth - x);
+  inputs[8] = float(fruitDeltaX);
+  inputs[9] = float(fruitDeltaY);
+  inputs[10] = float((direction == Direction::Right) - (direction == Direction::Left));
+  inputs[11] = float((direction == Direction::Down) - (direction == Direction::Up));
+  inputs[12] = float(bodyLength[board]);
+};
+
+int BoardBatch::expectedDirection(const size_t &board)
+{
+  SNAKE_PROFILE(Pathfinding);
+  iPoint2D head{headX[board], headY[board]}, fruit{fruitX[board], fruitY[board]};
+  auto &path = findPath(pathfinding, words.data() + board * wordsPerBoard, gridWidth, gridHeight, head, fruit);
+  return snake::expectedDirection(path, head, fruit, gridWidth, gridHeight);
+};
+
+void BoardBatch::snapshot(const size_t &board, BoardSnapshot &snapshot)
+{
+  snapshot.segments.clear();
+  for (uint32_t index = 0; index < bodyLength[board]; ++index)
+  {
+    snapshot.segments.push_back(segment(board, index));
+  }
+  iPoint2D head{headX[board], headY[board]}, fruit{fruitX[board], fruitY[board]};
+  auto &path = findPath(pathfinding, words.data() + board * wordsPerBoard, gridWidth, gridHeight, head, fruit);
+  snapshot.path.assign(path.begin(), path.end());
+  snapshot.fruit = fruit;
+  snapshot.score = scores[board];
+  snapshot.gameOver = false;
+};
+
+void BoardBatch::pushFront(const size_t &board, const int &x, const int &y)
+{
+  auto first = bodyFirst[board] = (bodyFirst[board] - 1) & (ringCapacity - 1);
+  bodies[board * ringCapacity + first] = {uint16_t(x), uint16_t(y)};
+  ++bodyLength[board];
+  headX[board] = x;
+  headY[board] = y;
+  set(board, y * gridWidth + x);
+};
+
+void BoardBatch::popBack(const size_t &board)
+{
+  auto tail = segment(board, bodyLength[board] - 1);
+  --bodyLength[board];
+  unset(board, tail.y * gridWidth + tail.x);
+};
+
+// The bitboard and free-cell updates below mirror OccupancyGrid::set, reset and clear step for step
+void BoardBatch::set(const size_t &board, const int &index)
+{
+  auto boardFreeCells = freeCells.data() + board * cellsCount;
+  auto boardFreeSlots = freeSlots.data() + board * cellsCount;
+  auto slot = boardFreeSlots[index];
+  if (slot != OccupancyGrid::noSlot)
+  {
+    auto lastCell = boardFreeCells[--freeCounts[board]];
+    boardFreeCells[slot] = lastCell;
+    boardFreeSlots[lastCell] = slot;
+    boardFreeSlots[index] = OccupancyGrid::noSlot;
+  }
+  auto x = index % gridWidth, y = index / gridWidth;
+  auto columnIndex = x * gridHeight + y;
+  words[board * wordsPerBoard + (index >> 6)] |= uint64_t(1) << (index & 63);
+  columnWords[board * wordsPerBoard + (columnIndex >> 6)] |= uint64_t(1) << (columnIndex & 63);
+};
+
+void BoardBatch::unset(const size_t &board, const int &index)
+{
+  auto boardFreeSlots = freeSlots.data() + board * cellsCount;
+  if (boardFreeSlots[index] == OccupancyGrid::noSlot)
+  {
+    boardFreeSlots[index] = freeCounts[board];
+    freeCells[board * cellsCount + freeCounts[board]++] = index;
+  }
+  auto x = index % gridWidth, y = index / gridWidth;
+  auto columnIndex = x * gridHeight + y;
+  words[board * wordsPerBoard + (index >> 6)] &= ~(uint64_t(1) << (index & 63));
+  columnWords[board * wordsPerBoard + (columnIndex >> 6)] &= ~(uint64_t(1) << (columnIndex & 63));
+};
+
+void BoardBatch::clearOccupancy(const size_t &board)
+{
+  auto boardWords = words.begin() + board * wordsPerBoard;
+  auto boardColumnWords = columnWords.begin() + board * wordsPerBoard;
+  std::fill(boardWords, boardWords + wordsPerBoard, 0);
+  std::fill(boardColumnWords, boardColumnWords + wordsPerBoard, 0);
+  auto usedBits = cellsCount & 63;
+  if (usedBits)
+  {
+    boardWords[wordsPerBoard - 1] = ~uint64_t(0) << usedBits;
+    boardColumnWords[wordsPerBoard - 1] = boardWords[wordsPerBoard - 1];
+  }
+  for (uint32_t index = 0; index < uint32_t(cellsCount); ++index)
+  {
+    freeCells[board * cellsCount + index] = index;
+    freeSlots[board * cellsCount + index] = index;
+  }
+  freeCounts[board] = cellsCount;
+};
+
+void BoardBatch::setFruitToRandom(const size_t &board)
+{
+  if (freeCounts[board] > 0)
+  {
+    auto index = int(freeCells[board * cellsCount + randoms[board].below(freeCounts[board])]);
+    fruitX[board] = index % gridWidth;
+    fruitY[board] = index / gridWidth;
+  }
+};
@@ -0,0 +1,244 @@
+#include <Checkpoint.hpp>
+#include <Snake.hpp>
+#include <Tracer.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace snake;
+
+CheckpointOptions snake::checkpointOptions;
+
+#ifdef _WIN32
+bool snake::writeFileAtomically(const std::string &path, const char *data, const size_t &size)
+{
+  auto temporaryPath = path + ".tmp";
+  auto handle = CreateFileA(temporaryPath.c_str(), GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+  if (handle == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+  DWORD written = 0;
+  auto flushed = WriteFile(handle, data, DWORD(size), &written, 0) && written == size && FlushFileBuffers(handle);
+  CloseHandle(handle);
+  if (!flushed || !MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+  {
+    DeleteFileA(temporaryPath.c_str());
+    return false;
+  }
+  return true;
+};
+#else
+bool snake::writeFileAtomically(const std::string &path, const char *data, const size_t &size)
+{
+  auto temporaryPath = path + ".tmp";
+  auto descriptor = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (descriptor < 0)
+  {
+    return false;
+  }
+  size_t written = 0;
+  while (written < size)
+  {
+    auto result = ::write(descriptor, data + written, size - written);
+    if (result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (result <= 0)
+    {
+      break;
+    }
+    written += size_t(result);
+  }
+  auto flushed = written == size && ::fsync(descriptor) == 0;
+  flushed = ::close(descriptor) == 0 && flushed;
+  if (!flushed || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+  {
+    std::remove(temporaryPath.c_str());
+    return false;
+  }
+  // The rename only survives a power loss once the directory entry is on disk too
+  auto directory = std::filesystem::path(path).parent_path();
+  auto directoryDescriptor = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+  if (directoryDescriptor >= 0)
+  {
+    ::fsync(directoryDescriptor);
+    ::close(directoryDescriptor);
+  }
+  return true;
+};
+#endif
+
+uint64_t snake::checkpointChecksum(const char *data, const size_t &size, const uint64_t &hash)
+{
+  // FNV-1a
+  auto result = hash;
+  for (size_t index = 0; index < size; ++index)
+  {
+    result = (result ^ uint8_t(data[index])) * 1099511628211ull;
+  }
+  return result;
+};
+
+// Checksum of the header fields before the checksum itself, continued over the payload
+static uint64_t headerChecksum(const uint64_t &sequence, const uint64_t &payloadSize)
+{
+  char header[24];
+  std::memcpy(header, Checkpoint::magic, sizeof(Checkpoint::magic));
+  std::memcpy(header + 8, &sequence, sizeof(sequence));
+  std::memcpy(header + 16, &payloadSize, sizeof(payloadSize));
+  return checkpointChecksum(header, sizeof(header));
+};
+
+bool Checkpoint::readHeader(const std::string &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  char header[headerSize];
+  if (!file.read(header, headerSize) || std::memcmp(header, magic, sizeof(magic)) != 0)
+  {
+    return false;
+  }
+  this->path = path;
+  std::memcpy(&sequence, header + 8, sizeof(sequence));
+  std::memcpy(&payloadSize, header + 16, sizeof(payloadSize));
+  std::memcpy(&checksum, header + 24, sizeof(checksum));
+  return true;
+};
+
+bool Checkpoint::readPayload(std::shared_ptr<char> &payload) const
+{
+  std::error_code error;
+  auto fileSize = std::filesystem::file_size(path, error);
+  if (error || fileSize != headerSize + payloadSize || payloadSize == 0)
+  {
+    return false;
+  }
+  std::ifstream file(path, std::ios::binary);
+  payload.reset(new char[payloadSize], std::default_delete<char[]>());
+  return file.seekg(headerSize) && file.read(payload.get(), std::streamsize(payloadSize)) &&
+         checkpointChecksum(payload.get(), payloadSize, headerChecksum(sequence, payloadSize)) == checksum;
+};
+
+std::vector<Checkpoint> snake::listCheckpoints(const std::string &directory)
+{
+  std::vector<Checkpoint> checkpoints;
+  std::error_code error;
+  for (auto &entry : std::filesystem::directory_iterator(directory, error))
+  {
+    auto name = entry.path().filename().string();
+    Checkpoint checkpoint;
+    if (name.rfind("snake-", 0) == 0 && entry.path().extension() == ".ckpt" && checkpoint.readHeader(entry.path().string()))
+    {
+      checkpoints.push_back(checkpoint);
+    }
+  }
+  std::sort(checkpoints.begin(), checkpoints.end(), [](const Checkpoint &a, const Checkpoint &b)
+  {
+    return a.sequence > b.sequence;
+  });
+  return checkpoints;
+};
+
+// Serialises the periodic thread and saveAINetwork so two writers never pick the same sequence
+static std::mutex checkpointMutex;
+
+bool snake::saveCheckpoint(const char *payload, const size_t &size)
+{
+  std::lock_guard lock(checkpointMutex);
+  auto &directory = checkpointOptions.directory;
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  auto checkpoints = listCheckpoints(directory);
+  std::shared_ptr<char> newestPayload;
+  if (!checkpoints.empty() && checkpoints[0].payloadSize == size && checkpoints[0].readPayload(newestPayload) &&
+      std::memcmp(newestPayload.get(), payload, size) == 0)
+  {
+    return true;
+  }
+  uint64_t sequence = checkpoints.empty() ? 1 : checkpoints[0].sequence + 1;
+  char name[32];
+  std::snprintf(name, sizeof(name), "snake-%010llu.ckpt", (unsigned long long)sequence);
+  auto path = (std::filesystem::path(directory) / name).string();
+  std::vector<char> bytes(Checkpoint::headerSize + size);
+  uint64_t payloadSize = size;
+  auto checksum = checkpointChecksum(payload, size, headerChecksum(sequence, payloadSize));
+  std::memcpy(bytes.data(), Checkpoint::magic, sizeof(Checkpoint::magic));
+  std::memcpy(bytes.data() + 8, &sequence, sizeof(sequence));
+  std::memcpy(bytes.data() + 16, &payloadSize, sizeof(payloadSize));
+  std::memcpy(bytes.data() + 24, &checksum, sizeof(checksum));
+  std::memcpy(bytes.data() + Checkpoint::headerSize, payload, size);
+  if (!writeFileAtomically(path, bytes.data(), bytes.size()))
+  {
+    std::cerr << "Could not write checkpoint " << path << std::endl;
+    return false;
+  }
+  // checkpoints is newest first and does not include the one just written. Only checkpoints that verify count
+  // toward keep, so corrupt ones can never push out the last good one; they are deleted as they cannot be loaded
+  unsigned int kept = 1;
+  std::shared_ptr<char> olderPayload;
+  for (auto &checkpoint : checkpoints)
+  {
+    if (kept < checkpointOptions.keep && checkpoint.readPayload(olderPayload))
+    {
+      ++kept;
+      continue;
+    }
+    std::filesystem::remove(checkpoint.path, error);
+  }
+  return true;
+};
+
+bool snake::checkpointAINetwork()
+{
+  SNAKE_TRACE("checkpoint");
+  auto bytesSizePair = serializeAINetwork();
+  return saveCheckpoint(bytesSizePair.first.get(), bytesSizePair.second);
+};
+
+CheckpointThread::CheckpointThread(const double &intervalSeconds):
+  intervalSeconds(intervalSeconds)
+{
+  if (intervalSeconds > 0)
+  {
+    thread = std::thread(&CheckpointThread::run, this);
+  }
+};
+
+CheckpointThread::~CheckpointThread()
+{
+  {
+    std::lock_guard lock(stopMutex);
+    stopRequested = true;
+  }
+  stopCondition.notify_all();
+  if (thread.joinable())
+  {
+    thread.join();
+  }
+};
+
+void CheckpointThread::run()
+{
+  setTraceThreadName("checkpoint");
+  auto period = std::chrono::duration<double>(intervalSeconds);
+  std::unique_lock lock(stopMutex);
+  while (!stopCondition.wait_for(lock, period, [this] { return stopRequested; }))
+  {
+    lock.unlock();
+    checkpointAINetwork();
+    lock.lock();
+  }
+};
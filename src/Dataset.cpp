@@ -0,0 +1,258 @@
+#include <Dataset.hpp>
+#include <BatchTrainer.hpp>
+#include <Checkpoint.hpp>
+#include <NeuralNetwork.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+using namespace zeuron;
+using namespace snake;
+
+static std::string shardPath(const std::string &directory, const unsigned int &workerIndex, const unsigned int &shardIndex)
+{
+  char name[64];
+  std::snprintf(name, sizeof(name), "shard-%03u-%05u.bin", workerIndex, shardIndex);
+  return (std::filesystem::path(directory) / name).string();
+};
+
+static void turn(Snake &snake, const int &direction)
+{
+  switch (direction)
+  {
+    case 0: snake.onUpKey(true); break;
+    case 1: snake.onDownKey(true); break;
+    case 2: snake.onLeftKey(true); break;
+    default: snake.onRightKey(true); break;
+  }
+};
+
+// Sets stored to the samples that reached the worker's shards, fewer than samples when a shard could not be created or grown
+static void generateShards(const DatasetOptions &options, const unsigned int &workerIndex, const unsigned int &firstBoard,
+                           const unsigned int &boardsCount, const unsigned long long &samples, unsigned long long &stored)
+{
+  stored = 0;
+  std::vector<std::shared_ptr<Board>> boards;
+  for (unsigned int boardIndex = 0; boardIndex < boardsCount; ++boardIndex)
+  {
+    auto &board = *boards.emplace_back(std::make_shared<Board>(options.gridWidth, options.gridHeight, true,
+                                                               Random(options.seed, firstBoard + boardIndex)));
+    board.setPlanner(options.planner);
+  }
+  // Policy streams count down from the top so they never meet a board's
+  Random generator(options.seed, ~0ull - workerIndex);
+  ReplayFile shard;
+  unsigned int shardIndex = 0;
+  float inputs[SampleBatch::inputsCount], expectedOutputs[SampleBatch::outputsCount];
+  for (unsigned long long written = 0; written < samples;)
+  {
+    for (size_t boardIndex = 0; boardIndex < boards.size() && written < samples; ++boardIndex, ++written)
+    {
+      if (written % options.shardSamples == 0)
+      {
+        stored += shard.recordsCount;
+        shard.close();
+        auto path = shardPath(options.directory, workerIndex, shardIndex++);
+        if (!shard.openForAppend(path))
+        {
+          std::cerr << "Could not create " << path << std::endl;
+          return;
+        }
+      }
+      auto &board = *boards[boardIndex];
+      auto &aiSnake = (AISnake &)*board.snake;
+      auto head = aiSnake.segments.front();
+      auto input = aiSnake.computeInputs();
+      auto expectedOutput = aiSnake.computeExpectedOutputs(head);
+      std::copy(input.begin(), input.begin() + SampleBatch::inputsCount, inputs);
+      std::copy(expectedOutput.begin(), expectedOutput.begin() + SampleBatch::outputsCount, expectedOutputs);
+      shard.append(inputs, toLabel(expectedOutputs));
+      if (options.policy == DatasetPolicy::Random || generator.uniform() < options.randomMoves)
+      {
+        turn(aiSnake, generator.below(4));
+      }
+      else
+      {
+        aiSnake.applyOutputs(expectedOutput.data());
+      }
+      aiSnake.update();
+    }
+  }
+  stored += shard.recordsCount;
+  shard.close();
+};
+
+bool snake::generateDataset(const DatasetOptions &options)
+{
+  trainingAI = true;
+  std::error_code error;
+  std::filesystem::create_directories(options.directory, error);
+  if (error)
+  {
+    std::cerr << "Could not create " << options.directory << ": " << error.message() << std::endl;
+    return false;
+  }
+  // train-offline reads every shard in the directory, so shards left by an earlier run would be mixed in
+  for (auto &path : listDatasetShards(options.directory))
+  {
+    std::filesystem::remove(path);
+  }
+  auto threadsCount = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  threadsCount = std::min(threadsCount, std::max(1u, options.boards));
+  auto startTime = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  std::vector<unsigned long long> stored(threadsCount);
+  unsigned int firstBoard = 0;
+  for (unsigned int workerIndex = 0; workerIndex < threadsCount; ++workerIndex)
+  {
+    auto boardsCount = std::max(1u, options.boards / threadsCount + (workerIndex < options.boards % threadsCount));
+    auto samples = options.samples / threadsCount + (workerIndex < options.samples % threadsCount);
+    workers.emplace_back(generateShards, std::cref(options), workerIndex, firstBoard, boardsCount, samples,
+                         std::ref(stored[workerIndex]));
+    firstBoard += boardsCount;
+  }
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  unsigned long long total = 0;
+  for (auto &samples : stored)
+  {
+    total += samples;
+  }
+  std::cout << "Generated " << total << " samples with " << threadsCount << " threads and seed " << options.seed
+            << " in " << seconds << "s ("
+            << (unsigned long long)(total / seconds) << " samples/s)" << std::endl;
+  if (total < options.samples)
+  {
+    std::cerr << "Only " << total << " of " << options.samples << " samples reached " << options.directory << std::endl;
+    return false;
+  }
+  return true;
+};
+
+std::vector<std::string> snake::listDatasetShards(const std::string &directory)
+{
+  std::vector<std::string> shards;
+  std::error_code error;
+  for (auto &entry : std::filesystem::directory_iterator(directory, error))
+  {
+    auto name = entry.path().filename().string();
+    if (entry.is_regular_file() && name.rfind("shard-", 0) == 0 && entry.path().extension() == ".bin")
+    {
+      shards.push_back(entry.path().string());
+    }
+  }
+  std::sort(shards.begin(), shards.end());
+  return shards;
+};
+
+void snake::trainOffline(const OfflineTrainingOptions &options)
+{
+  auto shards = listDatasetShards(options.directory);
+  if (shards.empty())
+  {
+    std::cerr << "No shards in " << options.directory << std::endl;
+    return;
+  }
+  auto &aiNetworkRef = *aiNetwork;
+  BatchTrainer trainer;
+  trainer.learningRate = options.learningRate;
+  bool useBatchTrainer;
+  {
+    std::lock_guard lock(aiNetworkMutex);
+    useBatchTrainer = trainer.load(aiNetworkRef);
+  }
+  if (!useBatchTrainer)
+  {
+    std::cerr << "Batched training does not match aiNetwork, training one sample at a time" << std::endl;
+  }
+  auto batchSize = std::max(1u, options.batchSize);
+  auto windowSize = std::max<unsigned long long>(1, options.shuffleWindow);
+  Random generator(options.seed);
+  std::vector<float> windowInputs(windowSize * SampleBatch::inputsCount);
+  std::vector<uint8_t> windowLabels(windowSize);
+  std::vector<uint32_t> order(windowSize);
+  SampleBatch batch;
+  batch.reserve(batchSize);
+  float expectedOutputs[SampleBatch::outputsCount];
+  auto startTime = std::chrono::steady_clock::now();
+  // An epoch's weights go into a checkpoint at most every intervalSeconds, 0 leaves it to saveAINetwork
+  using clock = std::chrono::steady_clock;
+  auto interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(checkpointOptions.intervalSeconds));
+  auto nextCheckpoint = clock::now() + interval;
+  unsigned long long trained = 0;
+  for (unsigned int epoch = 0; epoch < options.epochs; ++epoch)
+  {
+    double epochError = 0;
+    unsigned long long epochSamples = 0;
+    // BatchTrainer keeps its own weights, only the fallback trains aiNetwork itself
+    std::unique_lock lock(aiNetworkMutex, std::defer_lock);
+    if (!useBatchTrainer)
+    {
+      lock.lock();
+    }
+    for (auto &path : shards)
+    {
+      ReplayFile shard;
+      if (!shard.openForReading(path))
+      {
+        std::cerr << "Skipping unreadable shard " << path << std::endl;
+        continue;
+      }
+      for (uint64_t first = 0; first < shard.recordsCount; first += windowSize)
+      {
+        auto windowRows = std::min<uint64_t>(windowSize, shard.recordsCount - first);
+        for (uint64_t row = 0; row < windowRows; ++row)
+        {
+          shard.read(first + row, windowInputs.data() + row * SampleBatch::inputsCount, windowLabels[row]);
+          order[row] = uint32_t(row);
+        }
+        std::shuffle(order.begin(), order.begin() + windowRows, generator);
+        for (uint64_t row = 0; row < windowRows; ++row)
+        {
+          fromLabel(windowLabels[order[row]], expectedOutputs);
+          batch.push(windowInputs.data() + order[row] * SampleBatch::inputsCount, expectedOutputs);
+          if (batch.size() == batchSize || row + 1 == windowRows)
+          {
+            if (useBatchTrainer)
+            {
+              trainer.train(batch);
+              epochError += trainer.batchError;
+            }
+            else
+            {
+              backpropagateSamples(aiNetworkRef, batch);
+            }
+            epochSamples += batch.size();
+            batch.clear();
+          }
+        }
+      }
+    }
+    trained += epochSamples;
+    std::cout << "epoch " << epoch + 1 << ": " << epochSamples << " samples";
+    if (useBatchTrainer && epochSamples)
+    {
+      std::cout << ", mean error " << epochError / epochSamples;
+    }
+    std::cout << std::endl;
+    if (useBatchTrainer)
+    {
+      lock.lock();
+      trainer.network.store(aiNetworkRef);
+    }
+    lock.unlock();
+    if (checkpointOptions.intervalSeconds > 0 && clock::now() >= nextCheckpoint)
+    {
+      checkpointAINetwork();
+      nextCheckpoint = clock::now() + interval;
+    }
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  std::cout << "Trained " << trained << " samples from " << shards.size() << " shards in " << seconds << "s" << std::endl;
+};
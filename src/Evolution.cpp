@@ -0,0 +1,295 @@
+#include <Evolution.hpp>
+#include <Training.hpp>
+#include <Checkpoint.hpp>
+#include <NeuralNetwork.hpp>
+#include <Tracer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using namespace zeuron;
+using namespace snake;
+
+EvolutionTrainer::EvolutionTrainer(const EvolutionOptions &options, NeuralNetwork &seed):
+  options(options),
+  pool(options.threads),
+  population(options.population),
+  offspring(population.size()),
+  episodeFitness(population.size() * std::max(1u, options.episodes)),
+  episodeScores(episodeFitness.size()),
+  generator(options.seed, ~0ull)
+{
+  this->options.episodes = std::max(1u, options.episodes);
+  this->options.elites = std::min<unsigned int>(options.elites, population.size());
+  seeded = population[0].network.load(seed) && population[0].network.validate(seed, 1e-3f);
+  if (!seeded)
+  {
+    return;
+  }
+  SnakeNetwork probe;
+  useSnakeNetwork = probe.load(population[0].network);
+  for (unsigned int worker = 0; useSnakeNetwork && worker < pool.size(); ++worker)
+  {
+    workerNetworks.emplace_back(std::make_unique<SnakeNetwork>());
+  }
+  // The seed stays in the population unchanged, the rest start as its mutants
+  for (size_t genomeIndex = 1; genomeIndex < population.size(); ++genomeIndex)
+  {
+    population[genomeIndex].network = population[0].network;
+    mutate(population[genomeIndex]);
+  }
+};
+
+double EvolutionTrainer::playEpisode(const Genome &genome, const unsigned int &worker, const unsigned int &episode, int &score)
+{
+  Board board(options.gridWidth, options.gridHeight, true, Random(options.seed, uint64_t(generation) * options.episodes + episode));
+  auto &aiSnake = (AISnake &)*board.snake;
+  if (useSnakeNetwork)
+  {
+    workerNetworks[worker]->load(genome.network);
+  }
+  float input[SnakeNetwork::inputs], outputs[SnakeNetwork::outputs];
+  long double decision[SnakeNetwork::outputs];
+  auto starvationTicks = options.gridWidth * options.gridHeight;
+  int ticks = 0, ticksSinceFruit = 0;
+  while (!board.gameOver && ticksSinceFruit < starvationTicks)
+  {
+    auto inputs = aiSnake.computeInputs();
+    std::copy(inputs.begin(), inputs.begin() + SnakeNetwork::inputs, input);
+    if (useSnakeNetwork)
+    {
+      workerNetworks[worker]->feedforward(input, outputs);
+    }
+    else
+    {
+      genome.network.feedforward(input, outputs);
+    }
+    std::copy(outputs, outputs + SnakeNetwork::outputs, decision);
+    aiSnake.applyOutputs(decision);
+    auto previousScore = board.score;
+    aiSnake.update();
+    ++ticks;
+    ticksSinceFruit = board.score > previousScore ? 0 : ticksSinceFruit + 1;
+  }
+  score = board.score;
+  return 1000.0 * board.score + ticks;
+};
+
+void EvolutionTrainer::evaluate()
+{
+  pool.run(episodeFitness.size(), [&](const size_t &task, const unsigned int &worker)
+  {
+    SNAKE_TRACE("play episode");
+    episodeFitness[task] = playEpisode(population[task / options.episodes], worker, task % options.episodes, episodeScores[task]);
+  });
+  for (size_t genomeIndex = 0; genomeIndex < population.size(); ++genomeIndex)
+  {
+    auto &genome = population[genomeIndex];
+    genome.fitness = 0;
+    genome.bestScore = 0;
+    for (unsigned int episode = 0; episode < options.episodes; ++episode)
+    {
+      auto task = genomeIndex * options.episodes + episode;
+      genome.fitness += episodeFitness[task] / options.episodes;
+      genome.bestScore = std::max(genome.bestScore, episodeScores[task]);
+    }
+  }
+};
+
+void EvolutionTrainer::rescore(Genome &genome)
+{
+  std::vector<double> fitness(options.episodes);
+  std::vector<int> scores(options.episodes);
+  pool.run(options.episodes, [&](const size_t &task, const unsigned int &worker)
+  {
+    SNAKE_TRACE("play episode");
+    fitness[task] = playEpisode(genome, worker, unsigned(task), scores[task]);
+  });
+  genome.fitness = 0;
+  genome.bestScore = 0;
+  for (unsigned int episode = 0; episode < options.episodes; ++episode)
+  {
+    genome.fitness += fitness[episode] / options.episodes;
+    genome.bestScore = std::max(genome.bestScore, scores[episode]);
+  }
+};
+
+void EvolutionTrainer::mutate(Genome &genome)
+{
+  std::normal_distribution<float> strengthDistribution(0.0f, float(options.mutationStrength));
+  for (auto &layer : genome.network.layers)
+  {
+    for (unsigned int input = 0; input < layer.inputs; ++input)
+    {
+      for (unsigned int output = 0; output < layer.outputs; ++output)
+      {
+        if (generator.uniform() < options.mutationRate)
+        {
+          layer.weights[input * layer.paddedOutputs + output] += strengthDistribution(generator);
+        }
+      }
+    }
+    for (unsigned int output = 0; output < layer.outputs; ++output)
+    {
+      if (generator.uniform() < options.mutationRate)
+      {
+        layer.biases[output] += strengthDistribution(generator);
+      }
+    }
+  }
+};
+
+// Each neuron takes its incoming weights and bias from one parent, so features learned as a unit survive
+void EvolutionTrainer::crossover(const Genome &first, const Genome &second, Genome &child)
+{
+  child.network = first.network;
+  for (size_t layerIndex = 0; layerIndex < child.network.layers.size(); ++layerIndex)
+  {
+    auto &layer = child.network.layers[layerIndex];
+    auto &secondLayer = second.network.layers[layerIndex];
+    for (unsigned int output = 0; output < layer.outputs; ++output)
+    {
+      if (generator() >> 63)
+      {
+        continue;
+      }
+      for (unsigned int input = 0; input < layer.inputs; ++input)
+      {
+        layer.weights[input * layer.paddedOutputs + output] = secondLayer.weights[input * layer.paddedOutputs + output];
+      }
+      layer.biases[output] = secondLayer.biases[output];
+    }
+  }
+};
+
+const Genome &EvolutionTrainer::select()
+{
+  auto *winner = &population[generator.below(uint32_t(population.size()))];
+  for (unsigned int round = 1; round < options.tournamentSize; ++round)
+  {
+    auto &challenger = population[generator.below(uint32_t(population.size()))];
+    if (challenger.fitness > winner->fitness)
+    {
+      winner = &challenger;
+    }
+  }
+  return *winner;
+};
+
+void EvolutionTrainer::breed()
+{
+  std::sort(population.begin(), population.end(), [](const Genome &a, const Genome &b)
+  {
+    return a.fitness > b.fitness;
+  });
+  for (size_t genomeIndex = 0; genomeIndex < offspring.size(); ++genomeIndex)
+  {
+    auto &child = offspring[genomeIndex];
+    if (genomeIndex < options.elites)
+    {
+      child.network = population[genomeIndex].network;
+      continue;
+    }
+    auto &first = select();
+    if (generator.uniform() < options.crossoverRate)
+    {
+      crossover(first, select(), child);
+    }
+    else
+    {
+      child.network = first.network;
+    }
+    mutate(child);
+  }
+  population.swap(offspring);
+};
+
+const Genome &EvolutionTrainer::best() const
+{
+  return *std::max_element(population.begin(), population.end(), [](const Genome &a, const Genome &b)
+  {
+    return a.fitness < b.fitness;
+  });
+};
+
+void EvolutionTrainer::run(const std::atomic<bool> &stopRequested)
+{
+  auto startTime = std::chrono::steady_clock::now();
+  Genome champion;
+  champion.fitness = -1;
+  for (generation = 0; !stopRequested && (options.generations == 0 || generation < options.generations); ++generation)
+  {
+    evaluate();
+    auto &generationBest = best();
+    double meanFitness = 0;
+    for (auto &genome : population)
+    {
+      meanFitness += genome.fitness / population.size();
+    }
+    // The champion's fitness came from earlier episodes, it replays this generation's before the comparison
+    if (champion.fitness >= 0)
+    {
+      rescore(champion);
+    }
+    if (generationBest.fitness > champion.fitness)
+    {
+      champion = generationBest;
+    }
+    std::cout << "generation " << generation + 1 << ": best fitness " << generationBest.fitness << ", mean fitness "
+              << meanFitness << ", best score " << generationBest.bestScore << std::endl;
+    if (onGeneration)
+    {
+      onGeneration(champion);
+    }
+    breed();
+  }
+  // Leave the best genome seen in population[0] for the caller
+  if (champion.fitness >= 0)
+  {
+    population[0] = champion;
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  std::cout << "Evolved " << population.size() << " genomes with " << pool.size() << " threads and seed " << options.seed << " in " << seconds
+            << "s, best fitness " << population[0].fitness << std::endl;
+};
+
+void snake::runEvolution(const EvolutionOptions &options)
+{
+  // Episodes end at the first collision, so Snake::update must not reset the board
+  trainingAI = false;
+  StopSignalScope stopSignalScope;
+  std::shared_ptr<NeuralNetwork> seed;
+  {
+    std::lock_guard lock(aiNetworkMutex);
+    seed = copyAINetwork(*aiNetwork);
+  }
+  EvolutionTrainer trainer(options, *seed);
+  if (!trainer.seeded)
+  {
+    std::cerr << "aiNetwork cannot be converted to a genome" << std::endl;
+    return;
+  }
+  // The champion goes into aiNetwork and a checkpoint at most every intervalSeconds, 0 leaves it to saveAINetwork
+  using clock = std::chrono::steady_clock;
+  auto interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(checkpointOptions.intervalSeconds));
+  auto nextCheckpoint = clock::now() + interval;
+  trainer.onGeneration = [&](const Genome &champion)
+  {
+    if (checkpointOptions.intervalSeconds <= 0 || clock::now() < nextCheckpoint)
+    {
+      return;
+    }
+    {
+      std::lock_guard lock(aiNetworkMutex);
+      champion.network.store(*aiNetwork);
+    }
+    checkpointAINetwork();
+    nextCheckpoint = clock::now() + interval;
+  };
+  trainer.run(StopSignalScope::stopRequested);
+  std::lock_guard lock(aiNetworkMutex);
+  if (!trainer.population[0].network.store(*aiNetwork))
+  {
+    std::cerr << "Could not write the best genome back into aiNetwork" << std::endl;
+  }
+};
@@ -0,0 +1,34 @@
+#include <InferenceNetwork.hpp>
+#include <immintrin.h>
+
+using namespace snake;
+
+// Only this file is built with AVX2/FMA, InferenceNetwork.cpp calls it after checking the CPU
+
+void snake::multiplyAccumulateAvx2(const float *weights, const float *biases, const unsigned int &inputs,
+                                   const unsigned int &paddedOutputs, const float *input, float *sums)
+{
+  for (unsigned int output = 0; output < paddedOutputs; output += 8)
+  {
+    auto sum = _mm256_loadu_ps(biases + output);
+    for (unsigned int inputIndex = 0; inputIndex < inputs; ++inputIndex)
+    {
+      sum = _mm256_fmadd_ps(_mm256_set1_ps(input[inputIndex]), _mm256_loadu_ps(weights + inputIndex * paddedOutputs + output), sum);
+    }
+    _mm256_storeu_ps(sums + output, sum);
+  }
+};
+
+void snake::multiplyAccumulateAvx2(const double *weights, const double *biases, const unsigned int &inputs,
+                                   const unsigned int &paddedOutputs, const double *input, double *sums)
+{
+  for (unsigned int output = 0; output < paddedOutputs; output += 4)
+  {
+    auto sum = _mm256_loadu_pd(biases + output);
+    for (unsigned int inputIndex = 0; inputIndex < inputs; ++inputIndex)
+    {
+      sum = _mm256_fmadd_pd(_mm256_set1_pd(input[inputIndex]), _mm256_loadu_pd(weights + inputIndex * paddedOutputs + output), sum);
+    }
+    _mm256_storeu_pd(sums + output, sum);
+  }
+};
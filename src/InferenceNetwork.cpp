@@ -0,0 +1,221 @@
+#include <InferenceNetwork.hpp>
+#include <NeuralNetwork.hpp>
+#include <cmath>
+#include <random>
+#include <type_traits>
+#if defined(SNAKE_AVX2_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace zeuron;
+using namespace snake;
+
+template <typename T>
+static T applyActivation(const Activation &activation, const T &x)
+{
+  switch (activation)
+  {
+    case Activation::HardSigmoid: return activate<Activation::HardSigmoid>(x);
+    case Activation::Tanh: return activate<Activation::Tanh>(x);
+    case Activation::Softplus: return activate<Activation::Softplus>(x);
+    case Activation::BentIdentity: return activate<Activation::BentIdentity>(x);
+  }
+  return x;
+};
+
+static bool toActivation(const NeuralNetwork::ActivationType &type, Activation &activation)
+{
+  switch (type)
+  {
+    case NeuralNetwork::HardSigmoid: activation = Activation::HardSigmoid; return true;
+    case NeuralNetwork::Tanh: activation = Activation::Tanh; return true;
+    case NeuralNetwork::Softplus: activation = Activation::Softplus; return true;
+    case NeuralNetwork::BentIdentity: activation = Activation::BentIdentity; return true;
+    default: return false;
+  }
+};
+
+/*
+ * The only place that touches Zeuron's internals: the layer specs the network
+ * was built with, weights[layer][neuron][input] and biases[layer][neuron].
+ * validate() catches any mismatch with Zeuron's own feedforward.
+ */
+template <typename T>
+bool InferenceNetwork<T>::load(const NeuralNetwork &network)
+{
+  inputs = network.inputSize;
+  if (inputs == 0 || inputs > maxLayerWidth || network.layers.empty())
+  {
+    return false;
+  }
+  layers.resize(network.layers.size());
+  auto layerInputs = inputs;
+  for (size_t layerIndex = 0; layerIndex < layers.size(); ++layerIndex)
+  {
+    auto &layer = layers[layerIndex];
+    auto &networkWeights = network.weights[layerIndex];
+    auto &networkBiases = network.biases[layerIndex];
+    layer.inputs = layerInputs;
+    layer.outputs = network.layers[layerIndex].second;
+    if (!toActivation(network.layers[layerIndex].first, layer.activation) || layer.outputs == 0 ||
+        layer.outputs > maxLayerWidth || networkWeights.size() != layer.outputs || networkBiases.size() != layer.outputs)
+    {
+      return false;
+    }
+    layer.paddedOutputs = (layer.outputs + lanePadding - 1) / lanePadding * lanePadding;
+    layer.weights.assign(layer.inputs * layer.paddedOutputs, T(0));
+    layer.biases.assign(layer.paddedOutputs, T(0));
+    for (unsigned int output = 0; output < layer.outputs; ++output)
+    {
+      if (networkWeights[output].size() != layer.inputs)
+      {
+        return false;
+      }
+      for (unsigned int input = 0; input < layer.inputs; ++input)
+      {
+        layer.weights[input * layer.paddedOutputs + output] = T(networkWeights[output][input]);
+      }
+      layer.biases[output] = T(networkBiases[output]);
+    }
+    layerInputs = layer.outputs;
+  }
+  return true;
+};
+
+template <typename T>
+bool InferenceNetwork<T>::store(NeuralNetwork &network) const
+{
+  if (network.inputSize != inputs || network.layers.size() != layers.size())
+  {
+    return false;
+  }
+  for (size_t layerIndex = 0; layerIndex < layers.size(); ++layerIndex)
+  {
+    auto &layer = layers[layerIndex];
+    if (network.layers[layerIndex].second != layer.outputs || network.weights[layerIndex].size() != layer.outputs ||
+        network.biases[layerIndex].size() != layer.outputs)
+    {
+      return false;
+    }
+  }
+  for (size_t layerIndex = 0; layerIndex < layers.size(); ++layerIndex)
+  {
+    auto &layer = layers[layerIndex];
+    auto &networkWeights = network.weights[layerIndex];
+    auto &networkBiases = network.biases[layerIndex];
+    for (unsigned int output = 0; output < layer.outputs; ++output)
+    {
+      for (unsigned int input = 0; input < layer.inputs; ++input)
+      {
+        networkWeights[output][input] = layer.weights[input * layer.paddedOutputs + output];
+      }
+      networkBiases[output] = layer.biases[output];
+    }
+  }
+  return true;
+};
+
+#ifdef SNAKE_AVX2_KERNELS
+// The rest of the program is built without AVX2, so the kernels are only used where the CPU has them
+static bool cpuSupportsAvx2()
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  auto fma = (info[2] >> 12) & 1, osxsave = (info[2] >> 27) & 1;
+  __cpuidex(info, 7, 0);
+  auto avx2 = (info[1] >> 5) & 1;
+  // The OS must also save the YMM registers
+  return fma && osxsave && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+};
+
+static const bool useAvx2 = cpuSupportsAvx2();
+#endif
+
+// sums[0, paddedOutputs) = biases + input * weights
+template <typename T>
+static void multiplyAccumulate(const typename InferenceNetwork<T>::Layer &layer, const T *input, T *sums)
+{
+  auto paddedOutputs = layer.paddedOutputs;
+  auto weights = layer.weights.data();
+#ifdef SNAKE_AVX2_KERNELS
+  if (useAvx2)
+  {
+    multiplyAccumulateAvx2(weights, layer.biases.data(), layer.inputs, paddedOutputs, input, sums);
+    return;
+  }
+#endif
+  for (unsigned int output = 0; output < paddedOutputs; ++output)
+  {
+    sums[output] = layer.biases[output];
+  }
+  for (unsigned int inputIndex = 0; inputIndex < layer.inputs; ++inputIndex)
+  {
+    auto value = input[inputIndex];
+    auto row = weights + inputIndex * paddedOutputs;
+    for (unsigned int output = 0; output < paddedOutputs; ++output)
+    {
+      sums[output] += value * row[output];
+    }
+  }
+};
+
+template <typename T>
+void InferenceNetwork<T>::feedforward(const T *input, T *outputs) const
+{
+  alignas(32) T buffers[2][maxLayerWidth];
+  auto current = input;
+  for (size_t layerIndex = 0; layerIndex < layers.size(); ++layerIndex)
+  {
+    auto &layer = layers[layerIndex];
+    auto next = buffers[layerIndex & 1];
+    multiplyAccumulate<T>(layer, current, next);
+    for (unsigned int output = 0; output < layer.outputs; ++output)
+    {
+      next[output] = applyActivation(layer.activation, next[output]);
+    }
+    current = next;
+  }
+  for (unsigned int output = 0; output < layers.back().outputs; ++output)
+  {
+    outputs[output] = current[output];
+  }
+};
+
+template <typename T>
+bool InferenceNetwork<T>::validate(NeuralNetwork &reference, const T &tolerance) const
+{
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> valueDistribution(-20.0, 20.0);
+  T input[maxLayerWidth], outputs[maxLayerWidth];
+  std::vector<long double> referenceInput(inputs);
+  for (int probe = 0; probe < 64; ++probe)
+  {
+    for (unsigned int inputIndex = 0; inputIndex < inputs; ++inputIndex)
+    {
+      referenceInput[inputIndex] = valueDistribution(generator);
+      input[inputIndex] = T(referenceInput[inputIndex]);
+    }
+    reference.feedforward(referenceInput);
+    auto referenceOutputs = reference.getOutputs();
+    feedforward(input, outputs);
+    if (referenceOutputs.size() != layers.back().outputs)
+    {
+      return false;
+    }
+    for (size_t output = 0; output < referenceOutputs.size(); ++output)
+    {
+      if (!(std::abs(referenceOutputs[output] - (long double)outputs[output]) <= tolerance))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+};
+
+template struct snake::InferenceNetwork<float>;
+template struct snake::InferenceNetwork<double>;
@@ -0,0 +1,47 @@
+#include <Json.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+using namespace snake;
+
+std::string snake::jsonString(const std::string &text)
+{
+  std::string quoted = "\"";
+  for (auto character : text)
+  {
+    switch (character)
+    {
+      case '"': quoted += "\\\""; break;
+      case '\\': quoted += "\\\\"; break;
+      case '\n': quoted += "\\n"; break;
+      case '\r': quoted += "\\r"; break;
+      case '\t': quoted += "\\t"; break;
+      case '\b': quoted += "\\b"; break;
+      case '\f': quoted += "\\f"; break;
+      default:
+        if (uint8_t(character) < 0x20)
+        {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(uint8_t(character)));
+          quoted += escaped;
+        }
+        else
+        {
+          quoted += character;
+        }
+    }
+  }
+  return quoted + "\"";
+};
+
+std::string snake::jsonNumber(const double &value)
+{
+  if (!std::isfinite(value))
+  {
+    return "null";
+  }
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.6g", value);
+  return text;
+};
@@ -0,0 +1,263 @@
+#include <MappedFile.hpp>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace snake;
+
+MappedFile::~MappedFile()
+{
+  close();
+};
+
+#ifdef _WIN32
+static bool setEndOfFile(void *fileHandle, const size_t &newSize)
+{
+  LARGE_INTEGER position;
+  position.QuadPart = LONGLONG(newSize);
+  return SetFilePointerEx(fileHandle, position, 0, FILE_BEGIN) && SetEndOfFile(fileHandle);
+};
+
+bool MappedFile::open(const std::string &path, const bool &writable)
+{
+  close();
+  this->writable = writable;
+  fileHandle = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, 0,
+                           writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+  if (fileHandle == INVALID_HANDLE_VALUE)
+  {
+    fileHandle = 0;
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(fileHandle, &fileSize))
+  {
+    close();
+    return false;
+  }
+  size = size_t(fileSize.QuadPart);
+  if (!map())
+  {
+    close();
+    return false;
+  }
+  return true;
+};
+
+bool MappedFile::map()
+{
+  if (size == 0)
+  {
+    return true;
+  }
+  mappingHandle = CreateFileMappingA(fileHandle, 0, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, 0);
+  if (!mappingHandle)
+  {
+    return false;
+  }
+  data = (char *)MapViewOfFile(mappingHandle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+  return data != 0;
+};
+
+void MappedFile::unmap()
+{
+  if (data)
+  {
+    UnmapViewOfFile(data);
+    data = 0;
+  }
+  if (mappingHandle)
+  {
+    CloseHandle(mappingHandle);
+    mappingHandle = 0;
+  }
+};
+
+bool MappedFile::resize(const size_t &newSize)
+{
+  if (!writable || !fileHandle)
+  {
+    return false;
+  }
+  auto oldSize = size;
+  unmap();
+  if (!setEndOfFile(fileHandle, newSize))
+  {
+    map();
+    return false;
+  }
+  size = newSize;
+  if (map())
+  {
+    return true;
+  }
+  // Put the old length and mapping back, or leave data null so callers see the file is unusable
+  unmap();
+  size = oldSize;
+  if (setEndOfFile(fileHandle, oldSize))
+  {
+    map();
+  }
+  return false;
+};
+
+void MappedFile::flush()
+{
+  if (data)
+  {
+    FlushViewOfFile(data, size);
+  }
+};
+
+void MappedFile::close()
+{
+  unmap();
+  if (fileHandle)
+  {
+    CloseHandle(fileHandle);
+    fileHandle = 0;
+  }
+  size = 0;
+};
+#else
+/*
+ * Grows by allocating the new blocks rather than leaving a sparse tail, so a
+ * full disk fails here instead of raising SIGBUS on a store into the mapping.
+ * A failed grow is truncated back to oldSize.
+ */
+static bool setLength(const int &descriptor, const size_t &oldSize, const size_t &newSize)
+{
+  if (newSize <= oldSize)
+  {
+    return ftruncate(descriptor, off_t(newSize)) == 0;
+  }
+#ifdef __APPLE__
+  static const char zeros[1 << 16] = {};
+  for (auto offset = oldSize; offset < newSize;)
+  {
+    auto written = pwrite(descriptor, zeros, std::min(sizeof(zeros), newSize - offset), off_t(offset));
+    if (written <= 0)
+    {
+      ftruncate(descriptor, off_t(oldSize));
+      return false;
+    }
+    offset += size_t(written);
+  }
+  return true;
+#else
+  if (posix_fallocate(descriptor, off_t(oldSize), off_t(newSize - oldSize)) != 0)
+  {
+    ftruncate(descriptor, off_t(oldSize));
+    return false;
+  }
+  return true;
+#endif
+};
+
+bool MappedFile::open(const std::string &path, const bool &writable)
+{
+  close();
+  this->writable = writable;
+  descriptor = ::open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if (descriptor < 0)
+  {
+    return false;
+  }
+  struct stat fileStat;
+  if (fstat(descriptor, &fileStat) != 0)
+  {
+    close();
+    return false;
+  }
+  size = size_t(fileStat.st_size);
+  if (!map())
+  {
+    close();
+    return false;
+  }
+  return true;
+};
+
+bool MappedFile::map()
+{
+  if (size == 0)
+  {
+    return true;
+  }
+  auto mapping = mmap(0, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+  if (mapping == MAP_FAILED)
+  {
+    return false;
+  }
+  data = (char *)mapping;
+  if (!writable)
+  {
+    madvise(data, size, MADV_SEQUENTIAL);
+  }
+  return true;
+};
+
+void MappedFile::unmap()
+{
+  if (data)
+  {
+    munmap(data, size);
+    data = 0;
+  }
+};
+
+bool MappedFile::resize(const size_t &newSize)
+{
+  if (!writable || descriptor < 0)
+  {
+    return false;
+  }
+  auto oldSize = size;
+  unmap();
+  if (!setLength(descriptor, oldSize, newSize))
+  {
+    map();
+    return false;
+  }
+  size = newSize;
+  if (map())
+  {
+    return true;
+  }
+  // Put the old length and mapping back, or leave data null so callers see the file is unusable
+  unmap();
+  size = oldSize;
+  if (ftruncate(descriptor, off_t(oldSize)) == 0)
+  {
+    map();
+  }
+  return false;
+};
+
+void MappedFile::flush()
+{
+  if (data)
+  {
+    msync(data, size, MS_SYNC);
+  }
+};
+
+void MappedFile::close()
+{
+  unmap();
+  if (descriptor >= 0)
+  {
+    ::close(descriptor);
+    descriptor = -1;
+  }
+  size = 0;
+};
+#endif
@@ -0,0 +1,219 @@
+#include <Profiler.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace snake;
+
+static const auto phasesCount = size_t(ProfilePhase::Count);
+
+const char *snake::profilePhaseName(const ProfilePhase &phase)
+{
+  static const char *names[] = {"inputs", "feedforward", "pathfinding", "backpropagate", "update", "batch step", "render"};
+  return names[size_t(phase)];
+};
+
+int PhaseHistogram::bucketIndex(const uint64_t &nanoseconds)
+{
+  if (nanoseconds < 4)
+  {
+    return int(nanoseconds);
+  }
+  auto octave = int(std::bit_width(nanoseconds)) - 1;
+  auto index = octave * 4 + int((nanoseconds >> (octave - 2)) & 3) - 4;
+  return std::min(index, bucketsCount - 1);
+};
+
+double PhaseHistogram::bucketNanoseconds(const int &bucket)
+{
+  if (bucket < 4)
+  {
+    return bucket;
+  }
+  auto octave = bucket / 4 + 1;
+  auto lower = std::ldexp(4 + bucket % 4, octave - 2);
+  return lower + std::ldexp(0.5, octave - 2);
+};
+
+void PhaseHistogram::record(const uint64_t &nanoseconds)
+{
+  // Single writer, a load and a store are enough and cheaper than fetch_add
+  auto &bucket = buckets[bucketIndex(nanoseconds)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  totalNanoseconds.store(totalNanoseconds.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+};
+
+struct ThreadProfile
+{
+  std::array<PhaseHistogram, phasesCount> phases;
+  std::atomic<bool> inUse{true};
+};
+
+// Histograms outlive their threads so exited workers still count, a new thread reuses a released set
+struct ProfileRegistry
+{
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadProfile>> profiles;
+};
+
+// Never destroyed, threads may still release their profile while statics are torn down
+static ProfileRegistry &profileRegistry()
+{
+  static auto registry = new ProfileRegistry;
+  return *registry;
+};
+
+struct ThreadProfileHandle
+{
+  ThreadProfile *profile = 0;
+  ~ThreadProfileHandle()
+  {
+    if (profile)
+    {
+      profile->inUse.store(false, std::memory_order_release);
+    }
+  };
+};
+
+static thread_local ThreadProfileHandle threadProfile;
+
+static ThreadProfile &acquireThreadProfile()
+{
+  auto &registry = profileRegistry();
+  std::lock_guard lock(registry.mutex);
+  for (auto &profile : registry.profiles)
+  {
+    if (!profile->inUse.load(std::memory_order_acquire))
+    {
+      profile->inUse.store(true, std::memory_order_relaxed);
+      return *profile;
+    }
+  }
+  return *registry.profiles.emplace_back(std::make_unique<ThreadProfile>());
+};
+
+void snake::recordPhase(const ProfilePhase &phase, const uint64_t &nanoseconds)
+{
+  if (!threadProfile.profile)
+  {
+    threadProfile.profile = &acquireThreadProfile();
+  }
+  threadProfile.profile->phases[size_t(phase)].record(nanoseconds);
+};
+
+PhaseStatistics snake::phaseStatistics(const ProfilePhase &phase)
+{
+  std::array<uint64_t, PhaseHistogram::bucketsCount> buckets{};
+  uint64_t totalNanoseconds = 0;
+  {
+    auto &registry = profileRegistry();
+    std::lock_guard lock(registry.mutex);
+    for (auto &profile : registry.profiles)
+    {
+      auto &histogram = profile->phases[size_t(phase)];
+      for (int bucket = 0; bucket < PhaseHistogram::bucketsCount; ++bucket)
+      {
+        buckets[bucket] += histogram.buckets[bucket].load(std::memory_order_relaxed);
+      }
+      totalNanoseconds += histogram.totalNanoseconds.load(std::memory_order_relaxed);
+    }
+  }
+  PhaseStatistics statistics;
+  // Counted from the buckets themselves so percentiles stay consistent while writers keep recording
+  for (auto bucketCount : buckets)
+  {
+    statistics.count += bucketCount;
+  }
+  if (!statistics.count)
+  {
+    return statistics;
+  }
+  statistics.meanNanoseconds = double(totalNanoseconds) / statistics.count;
+  auto p50Rank = (statistics.count + 1) / 2;
+  auto p99Rank = statistics.count - statistics.count / 100;
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < PhaseHistogram::bucketsCount; ++bucket)
+  {
+    auto previous = seen;
+    seen += buckets[bucket];
+    if (previous < p50Rank && seen >= p50Rank)
+    {
+      statistics.p50Nanoseconds = PhaseHistogram::bucketNanoseconds(bucket);
+    }
+    if (previous < p99Rank && seen >= p99Rank)
+    {
+      statistics.p99Nanoseconds = PhaseHistogram::bucketNanoseconds(bucket);
+      break;
+    }
+  }
+  return statistics;
+};
+
+std::string snake::formatNanoseconds(const double &nanoseconds)
+{
+  char text[32];
+  if (nanoseconds < 1e3)
+  {
+    std::snprintf(text, sizeof(text), "%.0fns", nanoseconds);
+  }
+  else if (nanoseconds < 1e6)
+  {
+    std::snprintf(text, sizeof(text), "%.1fus", nanoseconds / 1e3);
+  }
+  else
+  {
+    std::snprintf(text, sizeof(text), "%.1fms", nanoseconds / 1e6);
+  }
+  return text;
+};
+
+std::string snake::profileSummary()
+{
+  std::string summary;
+  for (size_t phase = 0; phase < phasesCount; ++phase)
+  {
+    auto statistics = phaseStatistics(ProfilePhase(phase));
+    if (!statistics.count)
+    {
+      continue;
+    }
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-14s %12llu calls  mean %9s  p50 %9s  p99 %9s\n", profilePhaseName(ProfilePhase(phase)),
+                  (unsigned long long)statistics.count, formatNanoseconds(statistics.meanNanoseconds).c_str(),
+                  formatNanoseconds(statistics.p50Nanoseconds).c_str(), formatNanoseconds(statistics.p99Nanoseconds).c_str());
+    summary += line;
+  }
+  return summary;
+};
+
+ProfileScope::ProfileScope(const ProfilePhase &phase):
+  phase(phase),
+  startTime(std::chrono::steady_clock::now())
+{};
+
+ProfileScope::~ProfileScope()
+{
+  auto elapsed = std::chrono::steady_clock::now() - startTime;
+  recordPhase(phase, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+};
+
+// Prints the totals once the program exits, nothing when no scope was ever timed
+struct ProfileExitReport
+{
+  ~ProfileExitReport()
+  {
+    auto summary = profileSummary();
+    if (!summary.empty())
+    {
+      std::cerr << "Phase timings:\n" << summary << std::flush;
+    }
+  };
+};
+
+static ProfileExitReport profileExitReport;
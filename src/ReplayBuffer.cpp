@@ -0,0 +1,181 @@
+#include <ReplayBuffer.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace snake;
+
+uint8_t snake::toLabel(const float *expectedOutputs)
+{
+  for (unsigned int output = 0; output < SampleBatch::outputsCount; ++output)
+  {
+    if (expectedOutputs[output] > 0.5f)
+    {
+      return uint8_t(output);
+    }
+  }
+  return uint8_t(SampleBatch::outputsCount);
+};
+
+void snake::fromLabel(const uint8_t &label, float *expectedOutputs)
+{
+  for (unsigned int output = 0; output < SampleBatch::outputsCount; ++output)
+  {
+    expectedOutputs[output] = output == label ? 1.0f : 0.0f;
+  }
+};
+
+ReplayFile::~ReplayFile()
+{
+  close();
+};
+
+bool ReplayFile::openForAppend(const std::string &path)
+{
+  if (!file.open(path, true))
+  {
+    return false;
+  }
+  this->path = path;
+  droppedRecords = 0;
+  if (file.size == 0)
+  {
+    if (!file.resize(headerSize + growthRecords * recordSize))
+    {
+      return false;
+    }
+    uint32_t inputsCount = SampleBatch::inputsCount, size = recordSize;
+    std::memcpy(file.data, magic, sizeof(magic));
+    std::memcpy(file.data + 8, &inputsCount, sizeof(inputsCount));
+    std::memcpy(file.data + 12, &size, sizeof(size));
+    recordsCount = 0;
+    std::memcpy(file.data + 16, &recordsCount, sizeof(recordsCount));
+    return true;
+  }
+  file.close();
+  if (!openForReading(path))
+  {
+    return false;
+  }
+  file.close();
+  return file.open(path, true);
+};
+
+bool ReplayFile::openForReading(const std::string &path)
+{
+  if (!file.open(path, false) || file.size < headerSize || std::memcmp(file.data, magic, sizeof(magic)) != 0)
+  {
+    file.close();
+    return false;
+  }
+  uint32_t inputsCount, size;
+  std::memcpy(&inputsCount, file.data + 8, sizeof(inputsCount));
+  std::memcpy(&size, file.data + 12, sizeof(size));
+  std::memcpy(&recordsCount, file.data + 16, sizeof(recordsCount));
+  if (inputsCount != SampleBatch::inputsCount || size != recordSize || headerSize + recordsCount * recordSize > file.size)
+  {
+    file.close();
+    return false;
+  }
+  return true;
+};
+
+void ReplayFile::append(const float *inputs, const uint8_t &label)
+{
+  auto offset = headerSize + recordsCount * recordSize;
+  if (!file.data || (offset + recordSize > file.size && !file.resize(offset + growthRecords * recordSize)))
+  {
+    if (droppedRecords++ == 0)
+    {
+      std::cerr << "Could not grow " << path << ", dropping samples" << std::endl;
+    }
+    return;
+  }
+  std::memcpy(file.data + offset, inputs, SampleBatch::inputsCount * sizeof(float));
+  file.data[offset + recordSize - 1] = char(label);
+  ++recordsCount;
+  std::memcpy(file.data + 16, &recordsCount, sizeof(recordsCount));
+};
+
+void ReplayFile::read(const uint64_t &index, float *inputs, uint8_t &label) const
+{
+  if (!file.data || index >= recordsCount)
+  {
+    std::fill(inputs, inputs + SampleBatch::inputsCount, 0.0f);
+    label = uint8_t(SampleBatch::outputsCount);
+    return;
+  }
+  auto record = file.data + headerSize + index * recordSize;
+  std::memcpy(inputs, record, SampleBatch::inputsCount * sizeof(float));
+  label = uint8_t(record[recordSize - 1]);
+};
+
+void ReplayFile::close()
+{
+  if (file.writable && file.data)
+  {
+    file.resize(headerSize + recordsCount * recordSize);
+  }
+  if (droppedRecords)
+  {
+    std::cerr << "Dropped " << droppedRecords << " samples that did not fit in " << path << std::endl;
+    droppedRecords = 0;
+  }
+  file.close();
+};
+
+ReplayBuffer::ReplayBuffer(const size_t &capacity):
+  capacity(std::clamp<size_t>(capacity, 1, maxCapacity)),
+  features(this->capacity * SampleBatch::inputsCount),
+  labels(this->capacity)
+{};
+
+bool ReplayBuffer::spillTo(const std::string &path)
+{
+  spilling = spillFile.openForAppend(path);
+  return spilling;
+};
+
+void ReplayBuffer::push(const SampleBatch &batch)
+{
+  for (size_t row = 0; row < batch.size(); ++row)
+  {
+    auto rowInputs = batch.inputs.data() + row * SampleBatch::inputsCount;
+    auto label = toLabel(batch.expectedOutputs.data() + row * SampleBatch::outputsCount);
+    for (unsigned int feature = 0; feature < SampleBatch::inputsCount; ++feature)
+    {
+      features[feature * capacity + next] = rowInputs[feature];
+    }
+    labels[next] = label;
+    next = next + 1 == capacity ? 0 : next + 1;
+    count = std::min(count + 1, capacity);
+    if (spilling)
+    {
+      spillFile.append(rowInputs, label);
+    }
+  }
+};
+
+void ReplayBuffer::sample(const size_t &rows, Random &generator, SampleBatch &batch) const
+{
+  if (count == 0)
+  {
+    return;
+  }
+  float inputs[SampleBatch::inputsCount], expectedOutputs[SampleBatch::outputsCount];
+  for (size_t row = 0; row < rows; ++row)
+  {
+    auto slot = generator.below(uint32_t(count));
+    for (unsigned int feature = 0; feature < SampleBatch::inputsCount; ++feature)
+    {
+      inputs[feature] = features[feature * capacity + slot];
+    }
+    fromLabel(labels[slot], expectedOutputs);
+    batch.push(inputs, expectedOutputs);
+  }
+};
+
+size_t ReplayBuffer::size() const
+{
+  return count;
+};
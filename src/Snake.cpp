@@ -1,39 +1,33 @@
 #include <Snake.hpp>
+#include <Profiler.hpp>
+#include <Tracer.hpp>
+#include <Checkpoint.hpp>
+#include <Training.hpp>
 #include <cassert>
-#include <queue>
 #include <fstream>
 #include <cmath>
+#include <bit>
 #include <iostream>
+#include <chrono>
+#include <filesystem>
 #include <NeuralNetwork.hpp>
 #include <ByteStream.hpp>
-#include <Visualizer.hpp>
 
 using namespace zeuron;
 using namespace bs;
 using namespace snake;
 
-static const auto cellSize = 20;
-static const auto cells = 20;
-auto boardWidth = cells * cellSize;
-auto boardHeight = cells * cellSize;
+int boardGridWidth = 20;
+int boardGridHeight = 20;
+int boardCellSize = 20;
+double boardTickRate = 10;
+unsigned int boardTrainingBatchSize = 64;
+bool profilerOverlay = false;
 bool trainingAI = false;
 
-std::shared_ptr<NeuralNetwork> loadOrCreateAINetwork();
-void saveAINetwork();
 std::mutex aiNetworkMutex;
 std::shared_ptr<NeuralNetwork> aiNetwork;
 
-int main()
-{
-  aiNetwork = loadOrCreateAINetwork();
-  Visualizer visualizer(*aiNetwork, 640, 480);
-  SnakeGame game((boardWidth * 2) + (boardWidth / 2), boardHeight + (boardHeight / 2));
-  game.awaitWindowThread();
-  visualizer.close();
-  visualizer.awaitWindowThread();
-  saveAINetwork();
-};
-
 ButtonEntity::ButtonEntity(anex::IGame& game,
 													 const char* text,
 													 const int& x,
@@ -71,6 +65,37 @@ void ButtonEntity::render()
 							 text, scale, 0x00ffffff);
 };
 
+ProfilerOverlay::ProfilerOverlay(anex::IGame &game):
+  IEntity(game)
+{};
+
+void ProfilerOverlay::render()
+{
+  auto now = std::chrono::steady_clock::now();
+  if (now >= nextRefresh)
+  {
+    lines.clear();
+    for (size_t phase = 0; phase < size_t(ProfilePhase::Count); ++phase)
+    {
+      auto statistics = phaseStatistics(ProfilePhase(phase));
+      if (statistics.count)
+      {
+        lines.push_back(std::string(profilePhaseName(ProfilePhase(phase))) + " p50 " +
+                        formatNanoseconds(statistics.p50Nanoseconds) + " p99 " + formatNanoseconds(statistics.p99Nanoseconds));
+      }
+    }
+    nextRefresh = now + std::chrono::milliseconds(500);
+  }
+  auto &fensterGame = (FensterGame &)game;
+  static const auto textScale = 2;
+  auto lineY = 4;
+  for (auto &line : lines)
+  {
+    fenster_text(fensterGame.f, 4, lineY, line.c_str(), textScale, 0x00ffffff);
+    lineY += fenster_text_bounds(line.c_str(), textScale).second + textScale * 2;
+  }
+};
+
 SnakeGame::SnakeGame(const int& windowWidth, const int& windowHeight):
 	FensterGame(windowWidth, windowHeight)
 {
@@ -91,31 +116,339 @@ bool iPoint2D::operator==(const iPoint2D &other) const
   return x == other.x && y == other.y;
 };
 
-Snake::Snake(anex::IGame &game, GameBoard &gameBoard):
-  IEntity(game),
-  gameBoard(gameBoard)
+SegmentRing::SegmentRing(const int &cellsCount):
+  cells(std::min<size_t>(std::bit_ceil(size_t(std::max(cellsCount, 1))), 64)),
+  mask(cells.size() - 1)
+{};
+
+size_t SegmentRing::size() const
+{
+  return count;
+};
+
+bool SegmentRing::empty() const
+{
+  return count == 0;
+};
+
+iPoint2D SegmentRing::front() const
+{
+  auto &cell = cells[first];
+  return {cell.x, cell.y};
+};
+
+iPoint2D SegmentRing::back() const
+{
+  auto &cell = cells[(first + count - 1) & mask];
+  return {cell.x, cell.y};
+};
+
+iPoint2D SegmentRing::operator[](const size_t &index) const
+{
+  auto &cell = cells[(first + index) & mask];
+  return {cell.x, cell.y};
+};
+
+void SegmentRing::push_front(const iPoint2D &point)
+{
+  if (count == cells.size())
+  {
+    grow();
+  }
+  first = (first - 1) & mask;
+  cells[first] = {uint16_t(point.x), uint16_t(point.y)};
+  ++count;
+};
+
+void SegmentRing::pop_back()
+{
+  --count;
+};
+
+void SegmentRing::clear()
+{
+  first = 0;
+  count = 0;
+};
+
+// Doubles the ring and unwraps it so the head is back at slot 0
+void SegmentRing::grow()
+{
+  std::vector<Cell> grown(cells.size() * 2);
+  for (size_t index = 0; index < count; ++index)
+  {
+    grown[index] = cells[(first + index) & mask];
+  }
+  cells.swap(grown);
+  mask = cells.size() - 1;
+  first = 0;
+};
+
+SegmentRing::Iterator SegmentRing::begin() const
+{
+  return {this, 0};
+};
+
+SegmentRing::Iterator SegmentRing::end() const
+{
+  return {this, count};
+};
+
+iPoint2D SegmentRing::Iterator::operator*() const
+{
+  return (*ring)[index];
+};
+
+SegmentRing::Iterator &SegmentRing::Iterator::operator++()
+{
+  ++index;
+  return *this;
+};
+
+bool SegmentRing::Iterator::operator==(const Iterator &other) const
+{
+  return index == other.index;
+};
+
+bool SegmentRing::Iterator::operator!=(const Iterator &other) const
+{
+  return index != other.index;
+};
+
+OccupancyGrid::OccupancyGrid(const int &width, const int &height):
+  width(width),
+  height(height),
+  words((width * height + 63) / 64),
+  columnWords(words.size()),
+  freeSlots(width * height)
+{
+  clear();
+};
+
+bool OccupancyGrid::test(const iPoint2D &point) const
+{
+  auto index = point.y * width + point.x;
+  return (words[index >> 6] >> (index & 63)) & 1;
+};
+
+void OccupancyGrid::set(const iPoint2D &point)
+{
+  auto index = point.y * width + point.x;
+  auto slot = freeSlots[index];
+  if (slot != noSlot)
+  {
+    // Swap-remove: the last free cell takes over the vacated slot
+    auto lastCell = freeCells.back();
+    freeCells[slot] = lastCell;
+    freeSlots[lastCell] = slot;
+    freeCells.pop_back();
+    freeSlots[index] = noSlot;
+  }
+  words[index >> 6] |= uint64_t(1) << (index & 63);
+  auto columnIndex = point.x * height + point.y;
+  columnWords[columnIndex >> 6] |= uint64_t(1) << (columnIndex & 63);
+};
+
+void OccupancyGrid::reset(const iPoint2D &point)
+{
+  auto index = point.y * width + point.x;
+  if (freeSlots[index] == noSlot)
+  {
+    freeSlots[index] = freeCells.size();
+    freeCells.push_back(index);
+  }
+  words[index >> 6] &= ~(uint64_t(1) << (index & 63));
+  auto columnIndex = point.x * height + point.y;
+  columnWords[columnIndex >> 6] &= ~(uint64_t(1) << (columnIndex & 63));
+};
+
+void OccupancyGrid::clear()
+{
+  std::fill(words.begin(), words.end(), 0);
+  std::fill(columnWords.begin(), columnWords.end(), 0);
+  // Bits past the last cell are marked occupied so free cell queries never see them
+  auto usedBits = (width * height) & 63;
+  if (usedBits)
+  {
+    words.back() = ~uint64_t(0) << usedBits;
+    columnWords.back() = words.back();
+  }
+  freeCells.resize(width * height);
+  for (uint32_t index = 0; index < freeCells.size(); ++index)
+  {
+    freeCells[index] = index;
+    freeSlots[index] = index;
+  }
+};
+
+int OccupancyGrid::freeCount() const
+{
+  return int(freeCells.size());
+};
+
+iPoint2D OccupancyGrid::nthFree(const int &n) const
+{
+  auto index = int(freeCells[n]);
+  return {index % width, index / width};
+};
+
+int snake::lastSetBit(const uint64_t *words, const int &begin, const int &end)
+{
+  if (begin >= end)
+  {
+    return -1;
+  }
+  auto wordIndex = (end - 1) >> 6;
+  auto word = words[wordIndex] & (~uint64_t(0) >> (63 - ((end - 1) & 63)));
+  auto firstWord = begin >> 6;
+  while (!word && wordIndex > firstWord)
+  {
+    word = words[--wordIndex];
+  }
+  if (!word)
+  {
+    return -1;
+  }
+  auto index = wordIndex * 64 + 63 - std::countl_zero(word);
+  return index >= begin ? index : -1;
+};
+
+int snake::firstSetBit(const uint64_t *words, const int &begin, const int &end)
+{
+  if (begin >= end)
+  {
+    return -1;
+  }
+  auto wordIndex = begin >> 6;
+  auto word = words[wordIndex] & (~uint64_t(0) << (begin & 63));
+  auto lastWord = (end - 1) >> 6;
+  while (!word && wordIndex < lastWord)
+  {
+    word = words[++wordIndex];
+  }
+  if (!word)
+  {
+    return -1;
+  }
+  auto index = wordIndex * 64 + std::countr_zero(word);
+  return index < end ? index : -1;
+};
+
+int OccupancyGrid::lastInRow(const int &y, const int &xEnd) const
+{
+  auto index = lastSetBit(words.data(), y * width, y * width + xEnd);
+  return index < 0 ? -1 : index - y * width;
+};
+
+int OccupancyGrid::firstInRow(const int &y, const int &xBegin) const
+{
+  auto index = firstSetBit(words.data(), y * width + xBegin, (y + 1) * width);
+  return index < 0 ? -1 : index - y * width;
+};
+
+int OccupancyGrid::lastInColumn(const int &x, const int &yEnd) const
+{
+  auto index = lastSetBit(columnWords.data(), x * height, x * height + yEnd);
+  return index < 0 ? -1 : index - x * height;
+};
+
+int OccupancyGrid::firstInColumn(const int &x, const int &yBegin) const
+{
+  auto index = firstSetBit(columnWords.data(), x * height + yBegin, (x + 1) * height);
+  return index < 0 ? -1 : index - x * height;
+};
+
+bool InputQueue::push(const Direction &direction)
+{
+  auto currentTail = tail.load(std::memory_order_relaxed);
+  if (currentTail - head.load(std::memory_order_acquire) == capacity)
+  {
+    return false;
+  }
+  items[currentTail % capacity] = direction;
+  tail.store(currentTail + 1, std::memory_order_release);
+  return true;
+};
+
+bool InputQueue::pop(Direction &direction)
+{
+  auto currentHead = head.load(std::memory_order_relaxed);
+  if (currentHead == tail.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+  direction = items[currentHead % capacity];
+  head.store(currentHead + 1, std::memory_order_release);
+  return true;
+};
+
+void InputQueue::clear()
+{
+  head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+};
+
+Direction snake::oppositeDirection(const Direction &direction)
+{
+  switch (direction)
+  {
+    case Direction::Up: return Direction::Down;
+    case Direction::Down: return Direction::Up;
+    case Direction::Left: return Direction::Right;
+    case Direction::Right: return Direction::Left;
+    default: return Direction::None;
+  }
+};
+
+Snake::Snake(Board &board):
+  board(board),
+  segments(board.gridWidth * board.gridHeight)
 {
   reset();
 };
 
-void Snake::render()
+void Snake::pushFront(const iPoint2D &head)
 {
-  auto &fensterGame = (FensterGame &)game;
-  bool firstSegment = true;
-  for (const auto &segment : segments)
+  segments.push_front(head);
+  board.occupancy.set(head);
+  ++board.stateVersion;
+  if (board.planner == Planner::DistanceField)
+  {
+    board.distanceField->block(board.occupancy, head);
+  }
+};
+
+void Snake::popBack()
+{
+  auto tail = segments.back();
+  board.occupancy.reset(tail);
+  segments.pop_back();
+  ++board.stateVersion;
+  if (board.planner == Planner::DistanceField)
   {
-    int renderX = gameBoard.x + (segment.x - cells / 2) * gameBoard.cellSize;
-    int renderY = gameBoard.y + (segment.y - cells / 2) * gameBoard.cellSize;
-    fenster_rect(fensterGame.f, renderX, renderY, gameBoard.cellSize, gameBoard.cellSize, firstSegment ? 0x0000FF00 : 0x0000FF99);
-    if (firstSegment)
-      firstSegment = false;
+    board.distanceField->unblock(board.occupancy, tail);
   }
 };
 
+bool Snake::occupies(const iPoint2D &point) const
+{
+  return board.occupancy.test(point);
+};
+
 void Snake::update()
 {
-  if (!gameBoard.gameOver)
+  SNAKE_PROFILE(Update);
+  if (!board.gameOver)
   {
+    // Apply at most one queued turn, turns back into the body or along the current direction are dropped
+    Direction requested;
+    while (inputs.pop(requested))
+    {
+      if (requested != direction && requested != oppositeDirection(direction))
+      {
+        direction = requested;
+        break;
+      }
+    }
     // Get the current head position
     auto head = segments.front();
     switch (direction)
@@ -125,48 +458,46 @@ void Snake::update()
       case Direction::Left:  head.x--; break;
       case Direction::Right: head.x++; break;
     }
-    // Check collisions
+    // Wrap around the board edges
     if (head.x < 0)
     {
-      head.x = gameBoard.width / gameBoard.cellSize - 1;
+      head.x = board.gridWidth - 1;
     }
-    else if (head.x >= gameBoard.width / cellSize)
+    else if (head.x >= board.gridWidth)
     {
       head.x = 0;
     }
     else if (head.y < 0)
     {
-      head.y = gameBoard.height / gameBoard.cellSize - 1;
+      head.y = board.gridHeight - 1;
     }
-    else if (head.y >= gameBoard.height / cellSize)
+    else if (head.y >= board.gridHeight)
     {
       head.y = 0;
     }
-    else if (std::find(segments.begin(), segments.end(), head) != segments.end())
+    // Check collisions
+    if (occupies(head))
     {
-      gameBoard.gameOver = true;
+      board.gameOver = true;
       if (trainingAI)
       {
         // std::this_thread::sleep_for(std::chrono::seconds(2));
         reset();
-        gameBoard.gameOver = false;
-        gameBoard.score = 0;
-      }
-      else
-      {
-        return;
+        board.gameOver = false;
+        board.score = 0;
       }
+      return;
     }
     // Move the snake
-    segments.push_front(head);
-    if (head == gameBoard.fruit)
+    pushFront(head);
+    if (head == board.fruit)
     {
-      gameBoard.score++;
-      gameBoard.setFruitToRandom();
+      board.score++;
+      board.setFruitToRandom();
     }
     else
     {
-      segments.pop_back();
+      popBack();
     }
     // std::this_thread::sleep_for(std::chrono::milliseconds(200));
   }
@@ -174,51 +505,55 @@ void Snake::update()
 
 void Snake::onUpKey(const bool &pressed)
 {
-  if (!pressed || direction == Direction::Down)
+  if (pressed)
   {
-    return;
+    inputs.push(Direction::Up);
   }
-  direction = Direction::Up;
 };
 
 void Snake::onDownKey(const bool &pressed)
 {
-  if (!pressed || direction == Direction::Up)
+  if (pressed)
   {
-    return;
+    inputs.push(Direction::Down);
   }
-  direction = Direction::Down;
 };
 
 void Snake::onLeftKey(const bool &pressed)
 {
-  if (!pressed || direction == Direction::Right)
+  if (pressed)
   {
-    return;
+    inputs.push(Direction::Left);
   }
-  direction = Direction::Left;
 };
 
 void Snake::onRightKey(const bool &pressed)
 {
-  if (!pressed || direction == Direction::Left)
+  if (pressed)
   {
-    return;
+    inputs.push(Direction::Right);
   }
-  direction = Direction::Right;
 };
 
 void Snake::reset()
 {
   segments.clear();
-  iPoint2D head{cells / 2, cells / 2};
-  segments.push_back(head);
-  segments.push_back({head.x - 1, head.y});
+  inputs.clear();
+  board.occupancy.clear();
+  if (board.distanceField)
+  {
+    board.distanceField->dirty = true;
+  }
+  iPoint2D head{board.gridWidth / 2, board.gridHeight / 2};
+  pushFront({head.x - 1, head.y});
+  pushFront(head);
   direction = Direction::Right;
 };
 
 PlayerSnake::PlayerSnake(anex::IGame &game, GameBoard &gameBoard):
-  Snake(game, gameBoard)
+  Snake(gameBoard),
+  game(game),
+  gameBoard(gameBoard)
 {
   upKeyId = game.addKeyHandler(
     gameBoard.useKeys == GameBoard::UseKeys::WSAD ? 87 : 17,
@@ -246,8 +581,42 @@ PlayerSnake::~PlayerSnake()
   game.removeKeyHandler(gameBoard.useKeys == GameBoard::UseKeys::WSAD ? 68 : 19, rightKeyId);
 };
 
-AISnake::AISnake(anex::IGame &game, GameBoard &gameBoard):
-  Snake(game, gameBoard)
+size_t SampleBatch::size() const
+{
+  return expectedOutputs.size() / outputsCount;
+};
+
+bool SampleBatch::empty() const
+{
+  return expectedOutputs.empty();
+};
+
+void SampleBatch::reserve(const size_t &rows)
+{
+  inputs.reserve(rows * inputsCount);
+  expectedOutputs.reserve(rows * outputsCount);
+};
+
+void SampleBatch::clear()
+{
+  inputs.clear();
+  expectedOutputs.clear();
+};
+
+void SampleBatch::push(const std::vector<long double> &input, const std::vector<long double> &expectedOutput)
+{
+  inputs.insert(inputs.end(), input.begin(), input.begin() + inputsCount);
+  expectedOutputs.insert(expectedOutputs.end(), expectedOutput.begin(), expectedOutput.begin() + outputsCount);
+};
+
+void SampleBatch::push(const float *input, const float *expectedOutput)
+{
+  inputs.insert(inputs.end(), input, input + inputsCount);
+  expectedOutputs.insert(expectedOutputs.end(), expectedOutput, expectedOutput + outputsCount);
+};
+
+AISnake::AISnake(Board &board):
+  Snake(board)
 {};
 
 long double distance(const long double& a, const long double& b)
@@ -265,118 +634,203 @@ long double distance(const std::pair<long double, long double>& point1,
 
 void AISnake::activation()
 {
+  auto head = segments.front();
+  auto input = computeInputs();
+  if (playNetwork)
+  {
+    float playInput[SnakeNetwork::inputs], playOutputs[SnakeNetwork::outputs];
+    std::copy(input.begin(), input.end(), playInput);
+    {
+      SNAKE_PROFILE(Feedforward);
+      playNetwork->feedforward(playInput, playOutputs);
+    }
+    long double outputs[SnakeNetwork::outputs];
+    std::copy(playOutputs, playOutputs + SnakeNetwork::outputs, outputs);
+    applyOutputs(outputs);
+    return;
+  }
+  if (samples)
+  {
+    if (fastNetwork)
+    {
+      float fastInput[13], fastOutputs[4];
+      std::copy(input.begin(), input.end(), fastInput);
+      {
+        SNAKE_PROFILE(Feedforward);
+        fastNetwork->feedforward(fastInput, fastOutputs);
+      }
+      long double outputs[4];
+      std::copy(fastOutputs, fastOutputs + 4, outputs);
+      applyOutputs(outputs);
+    }
+    else
+    {
+      {
+        SNAKE_PROFILE(Feedforward);
+        network->feedforward(input);
+      }
+      applyOutputs(network->getOutputs().data());
+    }
+    samples->push(input, computeExpectedOutputs(head));
+    return;
+  }
+  // Play opponent whose network does not fit SnakeNetwork, decides without training
+  std::unique_lock lock(aiNetworkMutex, std::defer_lock);
+  {
+    SNAKE_TRACE("wait aiNetwork lock");
+    lock.lock();
+  }
   auto& aiNetworkRef = *aiNetwork;
-  auto gridHeight = gameBoard.height / cellSize;
-  auto gridWidth = gameBoard.width / cellSize;
+  {
+    SNAKE_PROFILE(Feedforward);
+    aiNetworkRef.feedforward(input);
+  }
+  applyOutputs(aiNetworkRef.getOutputs().data());
+};
+
+std::vector<long double> AISnake::computeInputs()
+{
+  SNAKE_PROFILE(Inputs);
+  auto gridHeight = board.gridHeight;
+  auto gridWidth = board.gridWidth;
   auto &segments = this->segments;
   auto head = segments.front();
-  auto &fruit = gameBoard.fruit;
+  auto &fruit = board.fruit;
   auto DistanceToWallUp = computeDistanceToWallUp(head, gridHeight);
   auto DistanceToWallDown = computeDistanceToWallDown(head, gridHeight);
   auto DistanceToWallLeft = computeDistanceToWallLeft(head, gridWidth);
   auto DistanceToWallRight = computeDistanceToWallRight(head, gridWidth);
-  auto DistanceToSnakeUp = computeDistanceToSnakeUp(head, segments);
-  auto DistanceToSnakeDown = computeDistanceToSnakeDown(head, segments, gridHeight);
-  auto DistanceToSnakeLeft = computeDistanceToSnakeLeft(head, segments);
-  auto DistanceToSnakeRight = computeDistanceToSnakeRight(head, segments, gridWidth);
+  long double distancesToSnake[4];
+  computeDistancesToSnake(head, distancesToSnake);
+  auto DistanceToSnakeUp = distancesToSnake[0];
+  auto DistanceToSnakeDown = distancesToSnake[1];
+  auto DistanceToSnakeLeft = distancesToSnake[2];
+  auto DistanceToSnakeRight = distancesToSnake[3];
   auto RelativeFruitX = computeRelativeFruitX(head, fruit, gridWidth);
   auto RelativeFruitY = computeRelativeFruitY(head, fruit, gridHeight);
   auto DirectionX = computeDirectionX(direction);
   auto DirectionY = computeDirectionY(direction);
   auto SnakeLength = computeSnakeLength(segments);
 
-  std::vector<long double> input({
+  return {
     DistanceToWallUp, DistanceToWallDown, DistanceToWallLeft, DistanceToWallRight,
     DistanceToSnakeUp, DistanceToSnakeDown, DistanceToSnakeLeft, DistanceToSnakeRight,
     RelativeFruitX, RelativeFruitY, DirectionX, DirectionY, SnakeLength
-  });
+  };
+};
+
+void AISnake::computeDistancesToSnake(const iPoint2D &head, long double (&distances)[4]) const
+{
+  auto &occupancy = board.occupancy;
+  auto up = occupancy.lastInColumn(head.x, head.y);
+  auto down = occupancy.firstInColumn(head.x, head.y + 1);
+  auto left = occupancy.lastInRow(head.y, head.x);
+  auto right = occupancy.firstInRow(head.y, head.x + 1);
+  // Rays that hit nothing report one past the wall, like the per-direction scans
+  distances[0] = static_cast<long double>(up < 0 ? head.y + 1 : head.y - up);
+  distances[1] = static_cast<long double>(down < 0 ? board.gridHeight - head.y : down - head.y);
+  distances[2] = static_cast<long double>(left < 0 ? head.x + 1 : head.x - left);
+  distances[3] = static_cast<long double>(right < 0 ? board.gridWidth - head.x : right - head.x);
+};
 
-  aiNetworkRef.feedforward(input);
-  auto outputs = aiNetworkRef.getOutputs();
+void AISnake::applyOutputs(const long double *outputs)
+{
+  auto direction = outputsDirection(outputs);
+  if (direction != Direction::None)
+  {
+    inputs.push(direction);
+  }
+};
 
+Direction snake::outputsDirection(const long double *outputs)
+{
   // Initial move decisions based on neural network output
   if (distance(outputs[0], 1) <= 0.05)
   {
-    onUpKey(true);
+    return Direction::Up;
   }
   else if (distance(outputs[1], 1) <= 0.05)
   {
-    onDownKey(true);
+    return Direction::Down;
   }
   else if (distance(outputs[2], 1) <= 0.05)
   {
-    onLeftKey(true);
+    return Direction::Left;
   }
   else if (distance(outputs[3], 1) <= 0.05)
   {
-    onRightKey(true);
+    return Direction::Right;
   }
+  return Direction::None;
+};
 
-  auto path = gameBoard.aStar(head, fruit);
+std::vector<long double> AISnake::computeExpectedOutputs(const iPoint2D &head)
+{
   std::vector<long double> expectedOutputs(4, 0.0); // Initialize to 0 for all directions
-
+  auto bestDirection = expectedDirection(board.optimalPath(), head, board.fruit, board.gridWidth, board.gridHeight);
   // If there is no path, stop the snake from moving
+  if (bestDirection != -1)
+  {
+    expectedOutputs[bestDirection] = 1.0;
+  }
+  return expectedOutputs;
+};
+
+int snake::expectedDirection(const std::vector<iPoint2D> &path, const iPoint2D &head, const iPoint2D &fruit,
+                             const int &gridWidth, const int &gridHeight)
+{
   if (path.empty())
   {
-    goto _backprop;
+    return -1;
   }
+  // Analyzing up to 3 steps ahead in the path
+  auto bestDirection = -1;
+  long double bestScore = -std::numeric_limits<long double>::infinity();
+  for (size_t i = 1; i <= std::min<size_t>(5, path.size() - 1); ++i)
   {
-    // Analyzing up to 3 steps ahead in the path
-    auto bestDirection = -1;
-    long double bestScore = -std::numeric_limits<long double>::infinity();
-    for (size_t i = 1; i <= std::min<size_t>(5, path.size() - 1); ++i)
-    {
-      auto nextMove = path[i];
-      auto deltaX = nextMove.x - head.x;
-      auto deltaY = nextMove.y - head.y;
+    auto nextMove = path[i];
+    auto deltaX = nextMove.x - head.x;
+    auto deltaY = nextMove.y - head.y;
 
-      // Calculate score based on proximity to fruit
-      long double score = 0.0;
-      if (nextMove == fruit)
-      {
-        score += 10.0; // Reward for moving towards the fruit
-      }
-      else
-      {
-        score += (gridWidth - std::abs(deltaX)) + (gridHeight - std::abs(deltaY)); // Reward for staying within the grid
-      }
-
-      // Determine the direction based on the step
-      int directionIndex = -1;
-      if (deltaX < 0)
-      {
-        directionIndex = 2; // Left
-      }
-      else if (deltaX > 0)
-      {
-        directionIndex = 3; // Right
-      }
-      else if (deltaY < 0)
-      {
-        directionIndex = 0; // Up
-      }
-      else if (deltaY > 0)
-      {
-        directionIndex = 1; // Down
-      }
+    // Calculate score based on proximity to fruit
+    long double score = 0.0;
+    if (nextMove == fruit)
+    {
+      score += 10.0; // Reward for moving towards the fruit
+    }
+    else
+    {
+      score += (gridWidth - std::abs(deltaX)) + (gridHeight - std::abs(deltaY)); // Reward for staying within the grid
+    }
 
-      // If this step has a higher score, select it as the best move
-      if (score > bestScore)
-      {
-        bestScore = score;
-        bestDirection = directionIndex;
-      }
+    // Determine the direction based on the step
+    int directionIndex = -1;
+    if (deltaX < 0)
+    {
+      directionIndex = 2; // Left
+    }
+    else if (deltaX > 0)
+    {
+      directionIndex = 3; // Right
+    }
+    else if (deltaY < 0)
+    {
+      directionIndex = 0; // Up
+    }
+    else if (deltaY > 0)
+    {
+      directionIndex = 1; // Down
     }
 
-    // Assign the best direction based on the analysis of the first 3 steps ahead
-    if (bestDirection != -1)
+    // If this step has a higher score, select it as the best move
+    if (score > bestScore)
     {
-      expectedOutputs[bestDirection] = 1.0;
+      bestScore = score;
+      bestDirection = directionIndex;
     }
   }
 
-_backprop:
-  aiNetworkRef.backpropagate(expectedOutputs);
+  return bestDirection;
 };
 
 bool AISnake::isCollisionAhead(const iPoint2D& head, Direction direction)
@@ -400,21 +854,13 @@ bool AISnake::isCollisionAhead(const iPoint2D& head, Direction direction)
   }
 
   // Check if the new position is a wall or part of the snake's body
-  if (nextPos.x < 0 || nextPos.x >= gameBoard.width / cellSize ||
-      nextPos.y < 0 || nextPos.y >= gameBoard.height / cellSize)
+  if (nextPos.x < 0 || nextPos.x >= board.gridWidth ||
+      nextPos.y < 0 || nextPos.y >= board.gridHeight)
   {
     return true; // Wall collision
   }
 
-  for (const auto& segment : segments)
-  {
-    if (nextPos == segment)
-    {
-      return true; // Snake body collision
-    }
-  }
-
-  return false; // No collision
+  return occupies(nextPos); // Snake body collision
 }
 
 // Function to compute distances to walls
@@ -435,7 +881,7 @@ long double AISnake::computeDistanceToWallRight(const iPoint2D& head, const int
 };
 
 // Function to compute distances to snake segments
-long double AISnake::computeDistanceToSnakeUp(const iPoint2D& head, const std::deque<iPoint2D>& segments) {
+long double AISnake::computeDistanceToSnakeUp(const iPoint2D& head, const SegmentRing& segments) {
     for (int y = head.y - 1; y >= 0; --y) {
         if (std::find(segments.begin(), segments.end(), iPoint2D{head.x, y}) != segments.end()) {
             return static_cast<long double>(head.y - y);
@@ -444,7 +890,7 @@ long double AISnake::computeDistanceToSnakeUp(const iPoint2D& head, const std::d
     return static_cast<long double>(head.y + 1);
 };
 
-long double AISnake::computeDistanceToSnakeDown(const iPoint2D& head, const std::deque<iPoint2D>& segments, const int &gridHeight) {
+long double AISnake::computeDistanceToSnakeDown(const iPoint2D& head, const SegmentRing& segments, const int &gridHeight) {
     for (int y = head.y + 1; y < gridHeight; ++y) {
         if (std::find(segments.begin(), segments.end(), iPoint2D{head.x, y}) != segments.end()) {
             return static_cast<long double>(y - head.y);
@@ -453,7 +899,7 @@ long double AISnake::computeDistanceToSnakeDown(const iPoint2D& head, const std:
     return static_cast<long double>(gridHeight - head.y);
 };
 
-long double AISnake::computeDistanceToSnakeLeft(const iPoint2D& head, const std::deque<iPoint2D>& segments) {
+long double AISnake::computeDistanceToSnakeLeft(const iPoint2D& head, const SegmentRing& segments) {
     for (int x = head.x - 1; x >= 0; --x) {
         if (std::find(segments.begin(), segments.end(), iPoint2D{x, head.y}) != segments.end()) {
             return static_cast<long double>(head.x - x);
@@ -462,7 +908,7 @@ long double AISnake::computeDistanceToSnakeLeft(const iPoint2D& head, const std:
     return static_cast<long double>(head.x + 1);
 };
 
-long double AISnake::computeDistanceToSnakeRight(const iPoint2D& head, const std::deque<iPoint2D>& segments, const int &gridWidth) {
+long double AISnake::computeDistanceToSnakeRight(const iPoint2D& head, const SegmentRing& segments, const int &gridWidth) {
     for (int x = head.x + 1; x < gridWidth; ++x) {
         if (std::find(segments.begin(), segments.end(), iPoint2D{x, head.y}) != segments.end()) {
             return static_cast<long double>(x - head.x);
@@ -504,10 +950,35 @@ long double AISnake::computeDirectionY(const Direction &direction) {
 };
 
 // Function to compute length of the snake
-long double AISnake::computeSnakeLength(const std::deque<iPoint2D>& segments) {
+long double AISnake::computeSnakeLength(const SegmentRing& segments) {
     return static_cast<long double>(segments.size());
 };
 
+Board::Board(const int &gridWidth, const int &gridHeight, const bool &isAI, const Random &random):
+  gridWidth(gridWidth),
+  gridHeight(gridHeight),
+  occupancy(gridWidth, gridHeight),
+  pathfinding(gridWidth * gridHeight),
+  isAI(isAI),
+  random(random)
+{
+  if (isAI)
+  {
+    snake = std::make_shared<AISnake>(*this);
+    setFruitToRandom();
+  }
+};
+
+void Board::tick()
+{
+  if (isAI)
+  {
+    auto aiSnake = std::dynamic_pointer_cast<AISnake>(snake);
+    aiSnake->activation();
+  }
+  snake->update();
+};
+
 GameBoard::GameBoard(anex::IGame &game,
                      const int &x,
                      const int &y,
@@ -517,176 +988,298 @@ GameBoard::GameBoard(anex::IGame &game,
                      const UseKeys &useKeys,
                      const bool &isAI):
   IEntity(game),
+  Board(width / cellSize, height / cellSize, isAI, Random(Random::entropySeed())),
   x(x),
   y(y),
   width(width),
   height(height),
   cellSize(cellSize),
-  useKeys(useKeys),
-  isAI(isAI)
+  useKeys(useKeys)
 {
-  snake = isAI ? std::dynamic_pointer_cast<Snake>(std::make_shared<AISnake>(game, *this)) :
-                 std::dynamic_pointer_cast<Snake>(std::make_shared<PlayerSnake>(game, *this));
-  setFruitToRandom();
+  if (!isAI)
+  {
+    snake = std::make_shared<PlayerSnake>(game, *this);
+    setFruitToRandom();
+  }
+  publishSnapshot();
+};
+
+void GameBoard::publishSnapshot()
+{
+  auto &snapshot = snapshots.writeSlot();
+  if (batchView)
+  {
+    batchView->snapshot(batchSlot, snapshot);
+    snapshots.publish();
+    return;
+  }
+  snapshot.segments.assign(snake->segments.begin(), snake->segments.end());
+  auto &path = optimalPath();
+  snapshot.path.assign(path.begin(), path.end());
+  snapshot.fruit = fruit;
+  snapshot.score = score;
+  snapshot.gameOver = gameOver;
+  snapshots.publish();
 };
 
 void GameBoard::render()
 {
-  if (isAI)
-  {
-    auto aiSnake = std::dynamic_pointer_cast<AISnake>(snake);
-    aiSnake->activation();
-  }
-  snake->update();
+  SNAKE_PROFILE(Render);
+  SNAKE_TRACE("render board");
+  auto &snapshot = snapshots.read();
   auto &fensterGame = (FensterGame &)game;
   int left = x - (width / 2);
   int top = y - (height / 2);
-  // Render grid using lines
-  for (int i = 0; i <= (width / cellSize); ++i)
+  // Render grid using lines, skipped when cells are too small for lines to be told apart
+  for (int i = 0; cellSize >= 4 && i <= gridWidth; ++i)
   {
     int lineX = left + i * cellSize;
     fenster_line(fensterGame.f, lineX, top, lineX, top + height - 1, 0x808080FF);
   }
-  for (int j = 0; j <= (height / cellSize); ++j)
+  for (int j = 0; cellSize >= 4 && j <= gridHeight; ++j)
   {
     int lineY = top + j * cellSize;
     fenster_line(fensterGame.f, left, lineY, left + width - 1, lineY, 0x808080FF);
   }
   // Render optimal path
+  for (auto &pathCell : snapshot.path)
   {
-    auto path = aStar(snake->segments.front(), fruit);
-    for (auto &pathCell : path)
-    {
-      int renderX = x + (pathCell.x - cells / 2) * cellSize;
-      int renderY = y + (pathCell.y - cells / 2) * cellSize;
-      fenster_rect(fensterGame.f, renderX, renderY, cellSize, cellSize, 0x00FF0000);
-    }
+    int renderX = left + pathCell.x * cellSize;
+    int renderY = top + pathCell.y * cellSize;
+    fenster_rect(fensterGame.f, renderX, renderY, cellSize, cellSize, 0x00FF0000);
   }
   // Render snake
-  snake->render();
+  bool firstSegment = true;
+  for (auto &segment : snapshot.segments)
+  {
+    int renderX = left + segment.x * cellSize;
+    int renderY = top + segment.y * cellSize;
+    fenster_rect(fensterGame.f, renderX, renderY, cellSize, cellSize, firstSegment ? 0x0000FF00 : 0x0000FF99);
+    firstSegment = false;
+  }
   // Render score and gameover text
   static const auto textScale = 5;
   static const auto textHeight = 5 * textScale;
-  auto text = "Score: " + std::to_string(score) + (gameOver ? " Game Over" : "");
+  auto text = "Score: " + std::to_string(snapshot.score) + (snapshot.gameOver ? " Game Over" : "");
   fenster_text(fensterGame.f, left, top - textHeight, text.c_str(), textScale, 0x00ffffff);
   // Render fruit
-  int fruitRenderX = left + fruit.x * cellSize;
-  int fruitRenderY = top + fruit.y * cellSize;
+  int fruitRenderX = left + snapshot.fruit.x * cellSize;
+  int fruitRenderY = top + snapshot.fruit.y * cellSize;
   fenster_rect(fensterGame.f, fruitRenderX, fruitRenderY, cellSize, cellSize, 0xFF0000FF);
 };
 
-void GameBoard::setFruitToRandom()
+BoardSnapshot &SnapshotBuffer::writeSlot()
 {
-  // Create a 2D boolean array to mark valid positions
-  std::vector<std::vector<bool>> validPositions(height / cellSize, std::vector<bool>(width / cellSize, true));
+  return slots[writeIndex];
+};
+
+void SnapshotBuffer::publish()
+{
+  writeIndex = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel) & (freshBit - 1);
+};
 
-  // Mark snake segments as invalid
+const BoardSnapshot &SnapshotBuffer::read()
+{
+  if (middle.load(std::memory_order_relaxed) & freshBit)
   {
-    for (const auto& segment : snake->segments) {
-      validPositions[segment.x][segment.y] = false;
-    }
+    readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & (freshBit - 1);
   }
+  return slots[readIndex];
+};
 
-  // Collect all valid positions
-  std::vector<iPoint2D> possiblePositions;
-  for (int x = 0; x < width / cellSize; ++x) {
-    for (int y = 0; y < height / cellSize; ++y) {
-      if (validPositions[x][y]) {
-        possiblePositions.push_back({x, y});
-      }
-    }
-  }
+SimulationThread::SimulationThread(const std::vector<std::shared_ptr<GameBoard>> &boards, const double &tickRate, const std::function<void()> &step):
+  boards(boards),
+  tickRate(tickRate),
+  step(step),
+  thread(&SimulationThread::run, this)
+{};
+
+SimulationThread::~SimulationThread()
+{
+  stop();
+};
 
-  // Randomly pick a valid position for the fruit
-  if (!possiblePositions.empty()) {
-    int randomIndex = rand() % possiblePositions.size();
-    fruit = possiblePositions[randomIndex];
+void SimulationThread::stop()
+{
+  {
+    std::lock_guard lock(stopMutex);
+    stopRequested = true;
+  }
+  stopCondition.notify_all();
+  if (thread.joinable())
+  {
+    thread.join();
   }
 };
 
-std::vector<std::vector<bool>> GameBoard::getGrid() const
+void SimulationThread::run()
 {
-  std::vector<std::vector<bool>> grid;
-  grid.resize(height / cellSize, std::vector<bool>(width / cellSize, false));
-  auto &snake = *this->snake;
-  for (auto &segment : snake.segments)
+  setTraceThreadName("simulation");
+  using clock = std::chrono::steady_clock;
+  auto unbounded = tickRate <= 0;
+  auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(unbounded ? 1.0 / 120 : 1.0 / tickRate));
+  auto nextTick = clock::now();
+  auto nextPublish = nextTick;
+  std::unique_lock lock(stopMutex);
+  while (!stopRequested)
   {
-    grid[segment.x][segment.y] = true;
+    lock.unlock();
+    {
+      SNAKE_TRACE("tick boards");
+      if (step)
+      {
+        step();
+      }
+      else
+      {
+        for (auto &board : boards)
+        {
+          board->tick();
+        }
+      }
+    }
+    auto now = clock::now();
+    auto publish = !unbounded || now >= nextPublish;
+    if (publish)
+    {
+      SNAKE_TRACE("publish snapshots");
+      for (auto &board : boards)
+      {
+        board->publishSnapshot();
+      }
+      nextPublish = now + period;
+    }
+    lock.lock();
+    if (unbounded)
+    {
+      continue;
+    }
+    nextTick += period;
+    // Drop ticks the thread fell behind on instead of running them back to back
+    if (nextTick < now)
+    {
+      nextTick = now;
+    }
+    SNAKE_TRACE("wait for tick");
+    stopCondition.wait_until(lock, nextTick, [this] { return stopRequested; });
   }
-  return grid;
 };
 
-size_t iPointHash2D::operator()(const iPoint2D& p) const
+void Board::setFruitToRandom()
 {
-  return std::hash<int>()(p.x) ^ std::hash<int>()(p.y);
+  auto freeCells = occupancy.freeCount();
+  if (freeCells > 0)
+  {
+    placeFruit(occupancy.nthFree(random.below(freeCells)));
+  }
 };
 
-int Node::fCost() const
+void Board::placeFruit(const iPoint2D &cell)
 {
-  return gCost + hCost; // Total cost
+  fruit = cell;
+  ++stateVersion;
+  if (distanceField)
+  {
+    distanceField->dirty = true;
+  }
 };
 
-// Compare Nodes for priority queue (min-heap)
-bool Node::operator<(const Node& other) const
+void Board::setPlanner(const Planner &planner)
 {
-  return fCost() > other.fCost(); // Higher cost -> lower priority
+  this->planner = planner;
+  // Built on first use, boards that plan with A* never pay for the field
+  if (planner == Planner::DistanceField && !distanceField)
+  {
+    distanceField = std::make_unique<DistanceField>(gridWidth, gridHeight);
+  }
+  if (distanceField)
+  {
+    distanceField->dirty = true;
+  }
+  optimalPathVersion = ~0ull;
 };
 
-// Check if a point is within bounds and not blocked
-bool isValid(int x, int y, const std::vector<std::vector<bool>>& grid)
+PathfindingWorkspace::PathfindingWorkspace(const int &cellsCount):
+  visited(cellsCount, 0),
+  closed(cellsCount, 0),
+  gCost(cellsCount, 0),
+  parent(cellsCount, -1)
+{};
+
+// Manhattan distance heuristic on the wrapping grid
+static int toroidalManhattanDistance(const int &ax, const int &ay, const int &bx, const int &by, const int &gridWidth, const int &gridHeight)
 {
-  return x >= 0 && x < grid.size() && y >= 0 && y < grid[0].size() && grid[x][y] == false;
+  auto dx = std::abs(ax - bx);
+  auto dy = std::abs(ay - by);
+  return std::min(dx, gridWidth - dx) + std::min(dy, gridHeight - dy);
 };
 
-// Manhattan distance heuristic
-int manhattanDistance(const iPoint2D& a, const iPoint2D& b)
+const std::vector<iPoint2D> &Board::aStar(const iPoint2D &start, const iPoint2D &target)
 {
-  return abs(a.x - b.x) + abs(a.y - b.y);
+  optimalPathVersion = ~0ull;
+  return findPath(pathfinding, occupancy.words.data(), gridWidth, gridHeight, start, target);
 };
 
-std::vector<iPoint2D> GameBoard::aStar(const iPoint2D &start, const iPoint2D &target) const
+const std::vector<iPoint2D> &snake::findPath(PathfindingWorkspace &workspace, const uint64_t *words, const int &gridWidth,
+                                             const int &gridHeight, const iPoint2D &start, const iPoint2D &target)
 {
   // Directions for movement: up, right, down, left
-  std::vector<iPoint2D> directions = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
-
-  // Priority queue for open list (min-heap based on fCost)
-  std::priority_queue<Node> openList;
+  static constexpr iPoint2D directions[] = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
 
-  // Maps to store gCost and parent of each point
-  std::unordered_map<iPoint2D, int, iPointHash2D> gCost;
-  std::unordered_map<iPoint2D, iPoint2D, iPointHash2D> parent;
+  workspace.path.clear();
+  if (++workspace.stamp == 0)
+  {
+    std::fill(workspace.visited.begin(), workspace.visited.end(), 0);
+    std::fill(workspace.closed.begin(), workspace.closed.end(), 0);
+    workspace.stamp = 1;
+  }
+  auto stamp = workspace.stamp;
+  auto startIndex = start.y * gridWidth + start.x;
+  auto targetIndex = target.y * gridWidth + target.x;
 
   // Initialize start node
-  gCost[start] = 0;
-  openList.push({start, 0, manhattanDistance(start, target)});
-
-  auto grid = getGrid();
-  int gridWidth = width / cellSize;
-  int gridHeight = height / cellSize;
-
-  while (!openList.empty())
+  workspace.visited[startIndex] = stamp;
+  workspace.gCost[startIndex] = 0;
+  workspace.parent[startIndex] = -1;
+  auto currentFCost = toroidalManhattanDistance(start.x, start.y, target.x, target.y, gridWidth, gridHeight);
+  workspace.buckets[currentFCost % 3].push_back(startIndex);
+  size_t openCount = 1;
+
+  while (openCount > 0)
   {
-    Node current = openList.top();
-    openList.pop();
+    auto &bucket = workspace.buckets[currentFCost % 3];
+    if (bucket.empty())
+    {
+      ++currentFCost;
+      continue;
+    }
+    auto currentIndex = bucket.back();
+    bucket.pop_back();
+    --openCount;
+    // Skip entries superseded by a cheaper push of the same cell
+    if (workspace.closed[currentIndex] == stamp)
+    {
+      continue;
+    }
+    workspace.closed[currentIndex] = stamp;
 
     // If we reached the target, reconstruct the path
-    if (current.point == target)
+    if (currentIndex == targetIndex)
     {
-      std::vector<iPoint2D> path;
-      iPoint2D p = target;
-      while (p != start) {
-        path.push_back(p);
-        p = parent[p];
+      for (auto index = targetIndex; index != -1; index = workspace.parent[index])
+      {
+        workspace.path.push_back({index % gridWidth, index / gridWidth});
       }
-      path.push_back(start);
-      std::reverse(path.begin(), path.end());
-      return path;
+      std::reverse(workspace.path.begin(), workspace.path.end());
+      break;
     }
 
+    iPoint2D current{currentIndex % gridWidth, currentIndex / gridWidth};
+    auto tentativeGCost = workspace.gCost[currentIndex] + 1; // Cost to move to neighbor
     // Explore neighbors
-    for (const iPoint2D& dir : directions)
+    for (const iPoint2D &dir : directions)
     {
-      iPoint2D neighbor = {current.point.x + dir.x, current.point.y + dir.y};
+      iPoint2D neighbor = {current.x + dir.x, current.y + dir.y};
 
       // Apply wrap-around logic
       if (neighbor.x < 0)
@@ -707,26 +1300,283 @@ std::vector<iPoint2D> GameBoard::aStar(const iPoint2D &start, const iPoint2D &ta
         neighbor.y = 0;
       }
 
-      // Check if the neighbor is valid
-      if (isValid(neighbor.x, neighbor.y, grid))
+      auto neighborIndex = neighbor.y * gridWidth + neighbor.x;
+      if (((words[neighborIndex >> 6] >> (neighborIndex & 63)) & 1) || workspace.closed[neighborIndex] == stamp)
+      {
+        continue;
+      }
+      if (workspace.visited[neighborIndex] != stamp || tentativeGCost < workspace.gCost[neighborIndex])
       {
-        int tentativeGCost = gCost[current.point] + 1; // Cost to move to neighbor
+        // Update gCost and parent
+        workspace.visited[neighborIndex] = stamp;
+        workspace.gCost[neighborIndex] = tentativeGCost;
+        workspace.parent[neighborIndex] = currentIndex;
+
+        // Add neighbor to open list
+        auto fCost = tentativeGCost + toroidalManhattanDistance(neighbor.x, neighbor.y, target.x, target.y, gridWidth, gridHeight);
+        workspace.buckets[fCost % 3].push_back(neighborIndex);
+        ++openCount;
+      }
+    }
+  }
 
-        if (gCost.find(neighbor) == gCost.end() || tentativeGCost < gCost[neighbor])
-        {
-          // Update gCost and parent
-          gCost[neighbor] = tentativeGCost;
-          parent[neighbor] = current.point;
+  for (auto &bucket : workspace.buckets)
+  {
+    bucket.clear();
+  }
+  // Empty if no path exists
+  return workspace.path;
+};
 
-          // Add neighbor to open list
-          openList.push({neighbor, tentativeGCost, manhattanDistance(neighbor, target)});
-        }
+const std::vector<iPoint2D> &Board::optimalPath()
+{
+  if (optimalPathVersion == stateVersion)
+  {
+    return pathfinding.path;
+  }
+  SNAKE_PROFILE(Pathfinding);
+  if (planner == Planner::AStar)
+  {
+    aStar(snake->segments.front(), fruit);
+    optimalPathVersion = stateVersion;
+    return pathfinding.path;
+  }
+  if (distanceField->dirty)
+  {
+    distanceField->rebuild(occupancy, fruit);
+  }
+  // Walk downhill from the head, each step is a lookup of the four neighbours
+  static constexpr iPoint2D directions[] = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+  auto &path = pathfinding.path;
+  path.clear();
+  auto current = snake->segments.front();
+  path.push_back(current);
+  while (!(current == fruit))
+  {
+    auto bestDistance = DistanceField::unreachable;
+    iPoint2D bestNeighbor = current;
+    for (const iPoint2D &dir : directions)
+    {
+      iPoint2D neighbor{(current.x + dir.x + gridWidth) % gridWidth, (current.y + dir.y + gridHeight) % gridHeight};
+      auto neighborDistance = distanceField->at(neighbor);
+      if (neighborDistance < bestDistance)
+      {
+        bestDistance = neighborDistance;
+        bestNeighbor = neighbor;
+      }
+    }
+    if (bestDistance == DistanceField::unreachable)
+    {
+      path.clear();
+      break;
+    }
+    current = bestNeighbor;
+    path.push_back(current);
+  }
+  optimalPathVersion = stateVersion;
+  return path;
+};
+
+DistanceField::DistanceField(const int &width, const int &height):
+  width(width),
+  height(height),
+  distance(width * height, unreachable),
+  affectedMark(width * height, 0)
+{
+  queue.reserve(width * height);
+  seeds.reserve(width * height);
+  affected.reserve(width * height);
+};
+
+int DistanceField::at(const iPoint2D &cell) const
+{
+  return distance[cell.y * width + cell.x];
+};
+
+void DistanceField::neighborIndices(const int &index, int (&neighbors)[4]) const
+{
+  auto y = index / width;
+  auto x = index - y * width;
+  auto row = index - x;
+  neighbors[0] = row + (x == 0 ? width - 1 : x - 1);
+  neighbors[1] = (y == height - 1 ? x : index + width);
+  neighbors[2] = row + (x == width - 1 ? 0 : x + 1);
+  neighbors[3] = (y == 0 ? (height - 1) * width + x : index - width);
+};
+
+static bool isOccupiedIndex(const OccupancyGrid &occupancy, const int &index)
+{
+  return (occupancy.words[index >> 6] >> (index & 63)) & 1;
+};
+
+void DistanceField::rebuild(const OccupancyGrid &occupancy, const iPoint2D &root)
+{
+  this->root = root;
+  std::fill(distance.begin(), distance.end(), unreachable);
+  seeds.clear();
+  queue.clear();
+  auto rootIndex = root.y * width + root.x;
+  if (!isOccupiedIndex(occupancy, rootIndex))
+  {
+    distance[rootIndex] = 0;
+    queue.push_back(rootIndex);
+  }
+  propagate(occupancy);
+  dirty = false;
+};
+
+/*
+ * Breadth first relaxation from the cells in seeds (sorted by distance) and
+ * queue (FIFO, already relaxed), always expanding the closer of the two fronts
+ */
+void DistanceField::propagate(const OccupancyGrid &occupancy)
+{
+  size_t seedIndex = 0, queueIndex = 0;
+  while (seedIndex < seeds.size() || queueIndex < queue.size())
+  {
+    int index;
+    if (queueIndex == queue.size() ||
+        (seedIndex < seeds.size() && distance[seeds[seedIndex]] <= distance[queue[queueIndex]]))
+    {
+      index = seeds[seedIndex++];
+    }
+    else
+    {
+      index = queue[queueIndex++];
+    }
+    auto nextDistance = distance[index] + 1;
+    int neighbors[4];
+    neighborIndices(index, neighbors);
+    for (auto neighbor : neighbors)
+    {
+      if (distance[neighbor] > nextDistance && !isOccupiedIndex(occupancy, neighbor))
+      {
+        distance[neighbor] = nextDistance;
+        queue.push_back(neighbor);
+      }
+    }
+  }
+  seeds.clear();
+  queue.clear();
+};
+
+void DistanceField::block(const OccupancyGrid &occupancy, const iPoint2D &cell)
+{
+  if (dirty)
+  {
+    return;
+  }
+  if (cell == root)
+  {
+    dirty = true;
+    return;
+  }
+  auto cellIndex = cell.y * width + cell.x;
+  if (distance[cellIndex] == unreachable)
+  {
+    return;
+  }
+  distance[cellIndex] = unreachable;
+  // Collect the cells whose every shortest path ran through cell, level by level
+  if (++affectedStamp == 0)
+  {
+    std::fill(affectedMark.begin(), affectedMark.end(), 0);
+    affectedStamp = 1;
+  }
+  affected.clear();
+  queue.clear();
+  int neighbors[4];
+  neighborIndices(cellIndex, neighbors);
+  queue.insert(queue.end(), neighbors, neighbors + 4);
+  for (size_t queueIndex = 0; queueIndex < queue.size(); ++queueIndex)
+  {
+    auto index = queue[queueIndex];
+    auto indexDistance = distance[index];
+    if (affectedMark[index] == affectedStamp || indexDistance == unreachable || indexDistance == 0)
+    {
+      continue;
+    }
+    neighborIndices(index, neighbors);
+    bool supported = false;
+    for (auto neighbor : neighbors)
+    {
+      supported = supported || (distance[neighbor] == indexDistance - 1 && affectedMark[neighbor] != affectedStamp);
+    }
+    if (supported)
+    {
+      continue;
+    }
+    affectedMark[index] = affectedStamp;
+    affected.push_back(index);
+    for (auto neighbor : neighbors)
+    {
+      if (distance[neighbor] == indexDistance + 1)
+      {
+        queue.push_back(neighbor);
+      }
+    }
+  }
+  queue.clear();
+  // Reattach the affected cells to their best unaffected neighbours and relax from there
+  for (auto index : affected)
+  {
+    distance[index] = unreachable;
+  }
+  for (auto index : affected)
+  {
+    auto best = unreachable;
+    neighborIndices(index, neighbors);
+    for (auto neighbor : neighbors)
+    {
+      auto neighborDistance = distance[neighbor];
+      if (neighborDistance != unreachable)
+      {
+        best = std::min(best, neighborDistance + 1);
       }
     }
+    if (best != unreachable)
+    {
+      distance[index] = best;
+      seeds.push_back(index);
+    }
   }
+  std::sort(seeds.begin(), seeds.end(), [&](const int &a, const int &b)
+  {
+    return distance[a] < distance[b];
+  });
+  propagate(occupancy);
+};
 
-  // Return empty path if no path exists
-  return {};
+void DistanceField::unblock(const OccupancyGrid &occupancy, const iPoint2D &cell)
+{
+  if (dirty)
+  {
+    return;
+  }
+  // A reset snake can spawn on top of the fruit, freeing it changes the whole field
+  if (cell == root)
+  {
+    dirty = true;
+    return;
+  }
+  auto cellIndex = cell.y * width + cell.x;
+  auto best = unreachable;
+  int neighbors[4];
+  neighborIndices(cellIndex, neighbors);
+  for (auto neighbor : neighbors)
+  {
+    auto neighborDistance = distance[neighbor];
+    if (neighborDistance != unreachable)
+    {
+      best = std::min(best, neighborDistance + 1);
+    }
+  }
+  distance[cellIndex] = best;
+  if (best != unreachable)
+  {
+    queue.push_back(cellIndex);
+    propagate(occupancy);
+  }
 };
 
 MainMenuScene::MainMenuScene(anex::IGame& game):
@@ -910,6 +1760,20 @@ SnakeScene::SnakeScene(anex::IGame &game, const unsigned int& boardsCount, const
   IScene(game)
 {
   assert(boardsCount == 1 || boardsCount == 2);
+  // AI opponents outside of training play with the compile-time network
+  std::shared_ptr<SnakeNetwork> playNetwork;
+  if (!trainingAI && (player1IsAI || player2IsAI))
+  {
+    playNetwork = std::make_shared<SnakeNetwork>();
+    std::lock_guard lock(aiNetworkMutex);
+    if (!loadSnakeNetwork(*aiNetwork, *playNetwork))
+    {
+      std::cerr << "aiNetwork does not match SnakeNetwork, AI opponents decide with aiNetwork" << std::endl;
+      playNetwork.reset();
+    }
+  }
+  auto boardWidth = boardGridWidth * boardCellSize;
+  auto boardHeight = boardGridHeight * boardCellSize;
   auto boardX = game.windowWidth / 2 - ((boardWidth / 2 + boardWidth / 8) * (boardsCount > 1 ? 1 : 0));
   auto boardY = game.windowHeight / 2;
 
@@ -918,15 +1782,53 @@ SnakeScene::SnakeScene(anex::IGame &game, const unsigned int& boardsCount, const
     auto isAI = i == 0 ? player1IsAI : player2IsAI;
     auto gameBoardIter = gameBoards.insert(gameBoards.end(), std::make_shared<GameBoard>(
       game, boardX, boardY, boardWidth, boardHeight,
-      cellSize, i == 0 && boardsCount == 2 ? GameBoard::UseKeys::WSAD : GameBoard::UseKeys::UpDownLeftRight,
+      boardCellSize, i == 0 && boardsCount == 2 ? GameBoard::UseKeys::WSAD : GameBoard::UseKeys::UpDownLeftRight,
       isAI));
     auto& gameBoard = **gameBoardIter;
+    if (isAI)
+    {
+      ((AISnake &)*gameBoard.snake).playNetwork = playNetwork;
+    }
     boardX += boardWidth + boardWidth / 4;
   }
   for (auto &gameBoard : gameBoards)
   {
     addEntity(gameBoard);
   }
+  if (profilerOverlay)
+  {
+    addEntity(std::make_shared<ProfilerOverlay>(game));
+  }
+  if (!trainingAI)
+  {
+    simulation = std::make_unique<SimulationThread>(gameBoards, boardTickRate);
+    return;
+  }
+  // Training boards only draw slots of one BoardBatch that the simulation thread steps and trains on
+  TrainingOptions options;
+  options.boards = boardsCount;
+  options.threads = 1;
+  options.batchSize = boardTrainingBatchSize;
+  options.gridWidth = gameBoards.front()->gridWidth;
+  options.gridHeight = gameBoards.front()->gridHeight;
+  trainingPool = std::make_unique<SimulationPool>(options);
+  auto &worker = *trainingPool->workers.front();
+  for (size_t slot = 0; slot < gameBoards.size(); ++slot)
+  {
+    gameBoards[slot]->batchView = worker.batch.get();
+    gameBoards[slot]->batchSlot = slot;
+  }
+  simulation = std::make_unique<SimulationThread>(gameBoards, 0, [this, &worker] { trainingPool->stepBatch(worker); });
+};
+
+SnakeScene::~SnakeScene()
+{
+  simulation->stop();
+  if (trainingPool)
+  {
+    // Samples short of a full batch
+    trainingPool->trainBatch(*trainingPool->workers.front());
+  }
 };
 
 std::pair<std::shared_ptr<char>, unsigned long> readFileToBuffer(const std::string& filename)
@@ -955,47 +1857,153 @@ std::pair<std::shared_ptr<char>, unsigned long> readFileToBuffer(const std::stri
 
 void writeBufferToFile(const char* buffer, unsigned long size, const std::string& filename)
 {
-  std::ofstream file(filename, std::ios::binary);
-  if (!file.is_open())
-  {
-    std::cerr << "Error: Unable to open file for writing.\n";
-    return;
-  }
-  file.write(buffer, static_cast<std::streamsize>(size));
-  if (!file)
+  // A crash mid-write leaves the previous file in place
+  if (!writeFileAtomically(filename, buffer, size))
   {
     std::cerr << "Error: Writing to the file failed.\n";
   }
-  file.close();
 };
 
-std::shared_ptr<NeuralNetwork> loadOrCreateAINetwork()
+static std::shared_ptr<NeuralNetwork> loadNetworkFile(const std::string &path)
 {
   try
   {
-    auto bytesSizePair = readFileToBuffer("snake.nrl");
+    auto bytesSizePair = readFileToBuffer(path);
     ByteStream byteStream(std::get<1>(bytesSizePair), std::get<0>(bytesSizePair));
     return std::make_shared<NeuralNetwork>(byteStream);
   }
   catch (...)
   {
-    return std::make_shared<NeuralNetwork>(
-      13, // Inputs: distance to walls [up, down, left, right], distance to snake segments [up, down, left, right], relative position of fruit (x, y), current direction (encoded as 2 values for direction x and y), and length of the snake
-      std::vector<std::pair<NeuralNetwork::ActivationType, unsigned long>>({
-        {NeuralNetwork::HardSigmoid, 32},
-        {NeuralNetwork::Tanh, 24},
-        {NeuralNetwork::Tanh, 16},
-        {NeuralNetwork::Softplus, 12},
-        {NeuralNetwork::BentIdentity, 8},
-        {NeuralNetwork::HardSigmoid, 4}
-      }),
-      0.01 // Reduced learning rate to account for the deeper architecture
-    );
+    return 0;
   }
 };
 
-void saveAINetwork()
+static std::shared_ptr<NeuralNetwork> loadCheckpoint(const Checkpoint &checkpoint)
+{
+  std::shared_ptr<char> payload;
+  if (checkpoint.readPayload(payload))
+  {
+    try
+    {
+      ByteStream byteStream(checkpoint.payloadSize, payload);
+      return std::make_shared<NeuralNetwork>(byteStream);
+    }
+    catch (...)
+    {
+    }
+  }
+  std::cerr << "Skipping corrupt checkpoint " << checkpoint.path << std::endl;
+  return 0;
+};
+
+// Keep in sync with SnakeNetwork in Snake.hpp
+static std::shared_ptr<NeuralNetwork> createFreshAINetwork()
+{
+  return std::make_shared<NeuralNetwork>(
+    13, // Inputs: distance to walls [up, down, left, right], distance to snake segments [up, down, left, right], relative position of fruit (x, y), current direction (encoded as 2 values for direction x and y), and length of the snake
+    std::vector<std::pair<NeuralNetwork::ActivationType, unsigned long>>({
+      {NeuralNetwork::HardSigmoid, 32},
+      {NeuralNetwork::Tanh, 24},
+      {NeuralNetwork::Tanh, 16},
+      {NeuralNetwork::Softplus, 12},
+      {NeuralNetwork::BentIdentity, 8},
+      {NeuralNetwork::HardSigmoid, 4}
+    }),
+    0.01 // Reduced learning rate to account for the deeper architecture
+  );
+};
+
+std::shared_ptr<NeuralNetwork> createAINetwork(const uint64_t &seed)
+{
+  auto network = createFreshAINetwork();
+  Random random(seed);
+  for (size_t layerIndex = 0; layerIndex < network->weights.size(); ++layerIndex)
+  {
+    for (auto &neuronWeights : network->weights[layerIndex])
+    {
+      // Uniform in +-1/sqrt(fan-in) keeps the first activations out of saturation
+      auto scale = 1 / std::sqrt(double(neuronWeights.size()));
+      for (auto &weight : neuronWeights)
+      {
+        weight = (random.uniform() * 2 - 1) * scale;
+      }
+    }
+    for (auto &bias : network->biases[layerIndex])
+    {
+      bias = 0;
+    }
+  }
+  return network;
+};
+
+std::shared_ptr<NeuralNetwork> loadAINetwork(std::string &source)
+{
+  auto checkpoints = listCheckpoints(checkpointOptions.directory);
+  std::error_code error;
+  auto networkFileTime = std::filesystem::last_write_time("snake.nrl", error);
+  // snake.nrl goes first when it was written after the newest checkpoint, for instance copied in by hand
+  auto networkFileFirst = !error && (checkpoints.empty() || networkFileTime > std::filesystem::last_write_time(checkpoints[0].path, error));
+  if (networkFileFirst)
+  {
+    if (auto network = loadNetworkFile("snake.nrl"))
+    {
+      source = "snake.nrl";
+      return network;
+    }
+  }
+  for (auto &checkpoint : checkpoints)
+  {
+    if (auto network = loadCheckpoint(checkpoint))
+    {
+      source = checkpoint.path;
+      return network;
+    }
+  }
+  if (!networkFileFirst)
+  {
+    if (auto network = loadNetworkFile("snake.nrl"))
+    {
+      source = "snake.nrl";
+      return network;
+    }
+  }
+  return 0;
+};
+
+std::shared_ptr<NeuralNetwork> loadOrCreateAINetwork()
+{
+  std::string source;
+  if (auto network = loadAINetwork(source))
+  {
+    return network;
+  }
+  return createFreshAINetwork();
+};
+
+std::shared_ptr<NeuralNetwork> copyAINetwork(const NeuralNetwork &network)
+{
+  auto nnStream = network.serialize();
+  ByteStream byteStream(nnStream.bytesSize, nnStream.bytes);
+  return std::make_shared<NeuralNetwork>(byteStream);
+};
+
+bool loadSnakeNetwork(NeuralNetwork &network, SnakeNetwork &snakeNetwork)
+{
+  InferenceNetwork<float> converted;
+  return converted.load(network) && converted.validate(network, 1e-3f) && snakeNetwork.load(converted);
+};
+
+std::pair<std::shared_ptr<char>, unsigned long> serializeAINetwork()
 {
+  std::lock_guard lock(aiNetworkMutex);
   auto nnStream = aiNetwork->serialize();
-  writeBufferToFile(nnStream.bytes.get(), nnStream.bytesSize, "snake.nrl");
+  return {nnStream.bytes, nnStream.bytesSize};
+};
+
+void saveAINetwork()
+{
+  SNAKE_TRACE("save network");
+  auto bytesSizePair = serializeAINetwork();
+  saveCheckpoint(bytesSizePair.first.get(), bytesSizePair.second);
+  writeBufferToFile(bytesSizePair.first.get(), bytesSizePair.second, "snake.nrl");
 };
\ No newline at end of file
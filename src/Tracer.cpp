@@ -0,0 +1,149 @@
+#include <Tracer.hpp>
+#include <Json.hpp>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace snake;
+
+std::atomic<bool> snake::tracingEnabled = false;
+
+static std::chrono::steady_clock::time_point traceStartTime;
+
+struct TraceRing
+{
+  // Written only by the owning thread, head counts every event ever recorded
+  std::array<TraceEvent, traceRingCapacity> events;
+  std::atomic<uint64_t> head{0};
+  std::string threadName;
+};
+
+// One ring per thread that recorded while tracing, never destroyed so late thread exits stay safe
+struct TraceRegistry
+{
+  std::mutex mutex;
+  std::vector<std::unique_ptr<TraceRing>> rings;
+  std::string path;
+};
+
+static TraceRegistry &traceRegistry()
+{
+  static auto registry = new TraceRegistry;
+  return *registry;
+};
+
+static thread_local TraceRing *threadRing = 0;
+static thread_local std::string threadName;
+
+void snake::startTracing(const std::string &path)
+{
+  auto &registry = traceRegistry();
+  {
+    std::lock_guard lock(registry.mutex);
+    registry.path = path;
+  }
+  traceStartTime = std::chrono::steady_clock::now();
+  tracingEnabled.store(true, std::memory_order_release);
+};
+
+int64_t snake::traceClock()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStartTime).count();
+};
+
+void snake::recordTraceEvent(const char *name, const int64_t &start, const int64_t &end)
+{
+  if (!threadRing)
+  {
+    auto &registry = traceRegistry();
+    std::lock_guard lock(registry.mutex);
+    threadRing = registry.rings.emplace_back(std::make_unique<TraceRing>()).get();
+    threadRing->threadName = threadName;
+  }
+  auto head = threadRing->head.load(std::memory_order_relaxed);
+  threadRing->events[head & (traceRingCapacity - 1)] = {name, start, end};
+  threadRing->head.store(head + 1, std::memory_order_release);
+};
+
+void snake::setTraceThreadName(const std::string &name)
+{
+  threadName = name;
+  if (threadRing)
+  {
+    std::lock_guard lock(traceRegistry().mutex);
+    threadRing->threadName = name;
+  }
+};
+
+/*
+ * Complete ("X") events with microsecond timestamps, one track per ring. A
+ * ring that wrapped only keeps its newest traceRingCapacity events.
+ */
+bool snake::writeTrace(const std::string &path)
+{
+  std::ofstream file(path);
+  file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  auto &registry = traceRegistry();
+  std::lock_guard lock(registry.mutex);
+  auto first = true;
+  char number[64];
+  for (size_t ringIndex = 0; ringIndex < registry.rings.size(); ++ringIndex)
+  {
+    auto &ring = *registry.rings[ringIndex];
+    auto tid = std::to_string(ringIndex + 1);
+    auto threadName = ring.threadName.empty() ? "thread " + tid : ring.threadName;
+    file << (first ? "\n" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+         << ", \"args\": {\"name\": " << jsonString(threadName) << "}}";
+    first = false;
+    auto head = ring.head.load(std::memory_order_acquire);
+    for (auto index = head > traceRingCapacity ? head - traceRingCapacity : 0; index < head; ++index)
+    {
+      auto &event = ring.events[index & (traceRingCapacity - 1)];
+      std::snprintf(number, sizeof(number), "%.3f, \"dur\": %.3f", event.start / 1e3, (event.end - event.start) / 1e3);
+      file << ",\n  {\"name\": " << jsonString(event.name) << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+           << ", \"ts\": " << number << "}";
+    }
+  }
+  file << "\n]}\n";
+  return bool(file);
+};
+
+TraceScope::TraceScope(const char *name):
+  name(name),
+  start(tracingEnabled.load(std::memory_order_acquire) ? traceClock() : -1)
+{};
+
+TraceScope::~TraceScope()
+{
+  if (start >= 0)
+  {
+    recordTraceEvent(name, start, traceClock());
+  }
+};
+
+// Writes the trace once the program exits, by then the threads that recorded have been joined
+struct TraceExitWriter
+{
+  ~TraceExitWriter()
+  {
+    if (!tracingEnabled)
+    {
+      return;
+    }
+    tracingEnabled = false;
+    auto path = traceRegistry().path;
+    if (!writeTrace(path))
+    {
+      std::cerr << "Could not write trace " << path << std::endl;
+      return;
+    }
+    std::cerr << "Wrote trace " << path << std::endl;
+  };
+};
+
+static TraceExitWriter traceExitWriter;
@@ -0,0 +1,300 @@
+#include <Training.hpp>
+#include <Profiler.hpp>
+#include <Tracer.hpp>
+#include <Checkpoint.hpp>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <NeuralNetwork.hpp>
+
+using namespace zeuron;
+using namespace snake;
+
+std::atomic<bool> StopSignalScope::stopRequested = false;
+
+static void onStopSignal(int)
+{
+  StopSignalScope::stopRequested = true;
+};
+
+StopSignalScope::StopSignalScope()
+{
+  stopRequested = false;
+  previousIntHandler = std::signal(SIGINT, onStopSignal);
+  previousTermHandler = std::signal(SIGTERM, onStopSignal);
+};
+
+StopSignalScope::~StopSignalScope()
+{
+  std::signal(SIGINT, previousIntHandler);
+  std::signal(SIGTERM, previousTermHandler);
+};
+
+SimulationPool::SimulationPool(const TrainingOptions &options):
+  options(options)
+{
+  auto threadsCount = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  threadsCount = std::min(threadsCount, std::max(1u, options.boards));
+  std::lock_guard lock(aiNetworkMutex);
+  if (options.fastInference)
+  {
+    InferenceNetwork<float> probeNetwork;
+    useFastNetwork = probeNetwork.load(*aiNetwork) && probeNetwork.validate(*aiNetwork, 1e-3f);
+    if (!useFastNetwork)
+    {
+      std::cerr << "Float inference does not match aiNetwork, using long double snapshots" << std::endl;
+    }
+  }
+  if (options.batchedTraining)
+  {
+    trainer.learningRate = options.learningRate;
+    useBatchTrainer = trainer.load(*aiNetwork);
+    if (!useBatchTrainer)
+    {
+      std::cerr << "Batched training does not match aiNetwork, training one sample at a time" << std::endl;
+    }
+  }
+  // Streams past every board index
+  replayGenerator = Random(options.seed, ~0ull);
+  if (options.replayCapacity)
+  {
+    replay = std::make_unique<ReplayBuffer>(options.replayCapacity);
+    if (!options.replayFile.empty() && !replay->spillTo(options.replayFile))
+    {
+      std::cerr << "Could not open replay file " << options.replayFile << std::endl;
+    }
+  }
+  for (unsigned int workerIndex = 0; workerIndex < threadsCount; ++workerIndex)
+  {
+    auto &worker = *workers.emplace_back(std::make_unique<Worker>());
+    if (useFastNetwork)
+    {
+      worker.fastNetwork.load(*aiNetwork);
+    }
+    else
+    {
+      worker.network = copyAINetwork(*aiNetwork);
+    }
+    worker.samples.reserve(this->options.batchSize);
+  }
+  useBatchSimulation = options.batchSimulation && options.planner == Planner::AStar;
+  if (options.batchSimulation && !useBatchSimulation)
+  {
+    std::cerr << "BoardBatch only plans with A*, simulating one Board per board instead" << std::endl;
+  }
+  if (useBatchSimulation)
+  {
+    for (unsigned int workerIndex = 0; workerIndex < threadsCount; ++workerIndex)
+    {
+      std::vector<Random> randoms;
+      for (auto boardIndex = workerIndex; boardIndex < options.boards; boardIndex += threadsCount)
+      {
+        randoms.emplace_back(options.seed, boardIndex);
+      }
+      workers[workerIndex]->batch = std::make_unique<BoardBatch>(options.gridWidth, options.gridHeight, randoms);
+    }
+    return;
+  }
+  for (unsigned int boardIndex = 0; boardIndex < options.boards; ++boardIndex)
+  {
+    auto &worker = *workers[boardIndex % threadsCount];
+    auto &board = *worker.boards.emplace_back(std::make_shared<Board>(options.gridWidth, options.gridHeight, true,
+                                                                      Random(options.seed, boardIndex)));
+    board.setPlanner(options.planner);
+    auto &aiSnake = (AISnake &)*board.snake;
+    aiSnake.network = worker.network.get();
+    aiSnake.fastNetwork = useFastNetwork ? &worker.fastNetwork : 0;
+    aiSnake.samples = &worker.samples;
+  }
+};
+
+void SimulationPool::run(const std::atomic<bool> &stopRequested)
+{
+  for (auto &worker : workers)
+  {
+    worker->thread = std::thread(useBatchSimulation ? &SimulationPool::batchWorkerLoop : &SimulationPool::workerLoop, this,
+                                 std::ref(*worker), std::cref(stopRequested));
+  }
+  std::cout << "Training with seed " << options.seed << std::endl;
+  auto startTime = std::chrono::steady_clock::now();
+  auto reportTime = startTime;
+  unsigned long long reportTicks = 0;
+  while (finishedWorkers < workers.size())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto now = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(now - reportTime).count();
+    if (options.reportInterval && seconds >= options.reportInterval)
+    {
+      unsigned long long currentTicks = ticks;
+      std::cout << "tick " << currentTicks << ": " << (unsigned long long)((currentTicks - reportTicks) / seconds)
+                << " ticks/s, " << samplesTrained << " samples trained, best score " << bestScore << std::endl;
+      std::cout << profileSummary() << std::flush;
+      reportTime = now;
+      reportTicks = currentTicks;
+    }
+  }
+  for (auto &worker : workers)
+  {
+    worker->thread.join();
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  std::cout << "Trained " << ticks << " ticks on " << options.boards << " boards with " << workers.size()
+            << " threads in " << seconds << "s, best score " << bestScore << std::endl;
+};
+
+// A plain compare-then-store could overwrite a higher score another worker stored in between
+static void raiseBestScore(std::atomic<int> &bestScore, const int &score)
+{
+  auto current = bestScore.load(std::memory_order_relaxed);
+  while (score > current && !bestScore.compare_exchange_weak(current, score, std::memory_order_relaxed))
+  {
+    // A failed exchange reloaded current, retry only while score is still higher
+  }
+};
+
+void SimulationPool::workerLoop(Worker &worker, const std::atomic<bool> &stopRequested)
+{
+  setTraceThreadName("training worker");
+  for (unsigned long long tick = 0; !stopRequested && (options.ticks == 0 || tick < options.ticks); ++tick)
+  {
+    SNAKE_TRACE("tick boards");
+    for (auto &board : worker.boards)
+    {
+      board->tick();
+      raiseBestScore(bestScore, board->score);
+      if (worker.samples.size() >= options.batchSize)
+      {
+        trainBatch(worker);
+      }
+    }
+    ticks += worker.boards.size();
+  }
+  trainBatch(worker);
+  ++finishedWorkers;
+};
+
+/*
+ * Same order of work as workerLoop: each board decides and records its
+ * sample in turn, training as soon as a batch is full so later boards decide
+ * with the updated network, then every board moves. Boards never interact,
+ * so moving them after all decisions changes nothing.
+ */
+void SimulationPool::batchWorkerLoop(Worker &worker, const std::atomic<bool> &stopRequested)
+{
+  setTraceThreadName("training worker");
+  for (unsigned long long tick = 0; !stopRequested && (options.ticks == 0 || tick < options.ticks); ++tick)
+  {
+    stepBatch(worker);
+  }
+  trainBatch(worker);
+  ++finishedWorkers;
+};
+
+void SimulationPool::stepBatch(Worker &worker)
+{
+  SNAKE_TRACE("tick boards");
+  auto &batch = *worker.batch;
+  float input[SampleBatch::inputsCount], fastOutputs[SampleBatch::outputsCount], expectedOutput[SampleBatch::outputsCount];
+  long double outputs[SampleBatch::outputsCount];
+  for (size_t board = 0; board < batch.count; ++board)
+  {
+    batch.computeInputs(board, input);
+    if (useFastNetwork)
+    {
+      SNAKE_PROFILE(Feedforward);
+      worker.fastNetwork.feedforward(input, fastOutputs);
+      std::copy(fastOutputs, fastOutputs + SampleBatch::outputsCount, outputs);
+    }
+    else
+    {
+      SNAKE_PROFILE(Feedforward);
+      worker.networkInput.assign(input, input + SampleBatch::inputsCount);
+      worker.network->feedforward(worker.networkInput);
+      std::copy_n(worker.network->getOutputs().data(), SampleBatch::outputsCount, outputs);
+    }
+    batch.turn(board, outputsDirection(outputs));
+    auto label = batch.expectedDirection(board);
+    for (unsigned int output = 0; output < SampleBatch::outputsCount; ++output)
+    {
+      expectedOutput[output] = int(output) == label ? 1.0f : 0.0f;
+    }
+    worker.samples.push(input, expectedOutput);
+    if (worker.samples.size() >= options.batchSize)
+    {
+      trainBatch(worker);
+    }
+  }
+  batch.step();
+  if (batch.count)
+  {
+    raiseBestScore(bestScore, *std::max_element(batch.scores.begin(), batch.scores.end()));
+  }
+  ticks += batch.count;
+};
+
+void SimulationPool::trainSamples(const SampleBatch &samples)
+{
+  SNAKE_PROFILE(Backpropagate);
+  auto &aiNetworkRef = *aiNetwork;
+  if (useBatchTrainer)
+  {
+    trainer.train(samples);
+    trainer.network.store(aiNetworkRef);
+    return;
+  }
+  backpropagateSamples(aiNetworkRef, samples);
+};
+
+void SimulationPool::trainBatch(Worker &worker)
+{
+  if (worker.samples.empty())
+  {
+    return;
+  }
+  auto trained = worker.samples.size();
+  {
+    std::unique_lock lock(aiNetworkMutex, std::defer_lock);
+    {
+      SNAKE_TRACE("wait aiNetwork lock");
+      lock.lock();
+    }
+    SNAKE_TRACE("train batch");
+    trainSamples(worker.samples);
+    if (replay)
+    {
+      replay->push(worker.samples);
+      replaySamples.clear();
+      replay->sample(worker.samples.size(), replayGenerator, replaySamples);
+      trainSamples(replaySamples);
+      trained += replaySamples.size();
+    }
+    if (useFastNetwork)
+    {
+      worker.fastNetwork.load(*aiNetwork);
+    }
+    else
+    {
+      worker.network = copyAINetwork(*aiNetwork);
+    }
+  }
+  samplesTrained += trained;
+  worker.samples.clear();
+  if (!useFastNetwork)
+  {
+    for (auto &board : worker.boards)
+    {
+      ((AISnake &)*board->snake).network = worker.network.get();
+    }
+  }
+};
+
+void snake::runHeadlessTraining(const TrainingOptions &options)
+{
+  trainingAI = true;
+  StopSignalScope stopSignalScope;
+  SimulationPool pool(options);
+  CheckpointThread checkpoints(checkpointOptions.intervalSeconds);
+  pool.run(StopSignalScope::stopRequested);
+};
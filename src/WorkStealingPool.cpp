@@ -0,0 +1,116 @@
+#include <WorkStealingPool.hpp>
+#include <Tracer.hpp>
+#include <algorithm>
+
+using namespace snake;
+
+WorkStealingPool::WorkStealingPool(const unsigned int &threadsCount)
+{
+  auto count = threadsCount ? threadsCount : std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int workerIndex = 0; workerIndex < count; ++workerIndex)
+  {
+    queues.emplace_back(std::make_unique<Queue>());
+  }
+  for (unsigned int workerIndex = 0; workerIndex < count; ++workerIndex)
+  {
+    threads.emplace_back(&WorkStealingPool::workerLoop, this, workerIndex);
+  }
+};
+
+WorkStealingPool::~WorkStealingPool()
+{
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+};
+
+unsigned int WorkStealingPool::size() const
+{
+  return queues.size();
+};
+
+void WorkStealingPool::run(const size_t &tasksCount, const Job &job)
+{
+  std::unique_lock lock(mutex);
+  this->job = job;
+  auto workersCount = queues.size();
+  for (size_t workerIndex = 0; workerIndex < workersCount; ++workerIndex)
+  {
+    auto &queue = *queues[workerIndex];
+    std::lock_guard queueLock(queue.mutex);
+    for (auto task = tasksCount * workerIndex / workersCount; task < tasksCount * (workerIndex + 1) / workersCount; ++task)
+    {
+      queue.tasks.push_back(task);
+    }
+  }
+  busyWorkers = workersCount;
+  ++generation;
+  wake.notify_all();
+  done.wait(lock, [&]
+  {
+    return busyWorkers == 0;
+  });
+};
+
+void WorkStealingPool::workerLoop(const unsigned int workerIndex)
+{
+  setTraceThreadName("pool worker " + std::to_string(workerIndex));
+  unsigned long long seenGeneration = 0;
+  while (true)
+  {
+    {
+      std::unique_lock lock(mutex);
+      wake.wait(lock, [&]
+      {
+        return stopping || generation != seenGeneration;
+      });
+      if (stopping)
+      {
+        return;
+      }
+      seenGeneration = generation;
+    }
+    size_t task;
+    while (nextTask(workerIndex, task))
+    {
+      job(task, workerIndex);
+    }
+    std::lock_guard lock(mutex);
+    if (--busyWorkers == 0)
+    {
+      done.notify_all();
+    }
+  }
+};
+
+bool WorkStealingPool::nextTask(const unsigned int &workerIndex, size_t &task)
+{
+  {
+    auto &queue = *queues[workerIndex];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty())
+    {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t offset = 1; offset < queues.size(); ++offset)
+  {
+    auto &queue = *queues[(workerIndex + offset) % queues.size()];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty())
+    {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+};
@@ -0,0 +1,583 @@
+#include <Snake.hpp>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <NeuralNetwork.hpp>
+#include <Visualizer.hpp>
+#include <Training.hpp>
+#include <Dataset.hpp>
+#include <ReplayBuffer.hpp>
+#include <Evolution.hpp>
+#include <Tracer.hpp>
+#include <Checkpoint.hpp>
+
+using namespace zeuron;
+using namespace snake;
+
+static const auto maxGridCells = 4096;
+
+// Parses "WxH" (or "N" for a square grid), false if a dimension is outside [4, maxGridCells]
+static bool parseGrid(const std::string &text, int &gridWidth, int &gridHeight)
+{
+  try
+  {
+    auto separator = text.find('x');
+    auto width = std::stoi(text.substr(0, separator));
+    auto height = separator == std::string::npos ? width : std::stoi(text.substr(separator + 1));
+    if (width < 4 || height < 4 || width > maxGridCells || height > maxGridCells)
+    {
+      return false;
+    }
+    gridWidth = width;
+    gridHeight = height;
+    return true;
+  }
+  catch (...)
+  {
+    return false;
+  }
+};
+
+// Parses all of text as a T, false on anything else including values a T cannot hold
+template <typename T>
+static bool parseNumber(const std::string &text, T &value)
+{
+  try
+  {
+    size_t end = 0;
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      auto parsed = std::stod(text, &end);
+      if (end != text.size() || !std::isfinite(parsed))
+      {
+        return false;
+      }
+      value = T(parsed);
+    }
+    else if constexpr (std::is_signed_v<T>)
+    {
+      auto parsed = std::stoll(text, &end);
+      if (end != text.size() || parsed < std::numeric_limits<T>::min() || parsed > std::numeric_limits<T>::max())
+      {
+        return false;
+      }
+      value = T(parsed);
+    }
+    else
+    {
+      // stoull would wrap "-1" around to the largest value
+      auto parsed = std::stoull(text, &end);
+      if (end != text.size() || text.find('-') != std::string::npos || parsed > std::numeric_limits<T>::max())
+      {
+        return false;
+      }
+      value = T(parsed);
+    }
+    return true;
+  }
+  catch (...)
+  {
+    return false;
+  }
+};
+
+static int printUsage()
+{
+  std::cerr << "Usage: snake [--trace PATH] [--start resume|fresh] [--grid WxH] [--cell-size N] [--tick-rate N] [--batch N] [--profile-overlay]\n"
+            << "       snake --train [--ticks N] [--boards N] [--threads N] [--batch N] [--trainer batch|sgd] [--learning-rate X] [--replay N [--replay-file PATH]] [--planner astar|field] [--inference float|long-double] [--sim batch|boards] [--grid WxH] [--seed N]\n"
+            << "       snake gen-dataset [--out DIR] [--samples N] [--boards N] [--threads N] [--shard-samples N] [--policy teacher|random] [--random-moves P] [--planner astar|field] [--grid WxH] [--seed N]\n"
+            << "       snake train-offline [--data DIR] [--epochs N] [--batch N] [--learning-rate X] [--shuffle N] [--seed N]\n"
+            << "       snake evolve [--generations N] [--population N] [--episodes N] [--elites N] [--crossover P] [--mutation-rate P] [--mutation-strength S] [--threads N] [--grid WxH] [--seed N]\n"
+            << "       --trace PATH before any command writes a Chrome trace of the run to PATH at exit\n"
+            << "       --start before any command resumes from snake.nrl or the newest checkpoint (the default), or starts from a fresh network;\n"
+            << "       --seed seeds the fresh network but never turns a resume into a fresh start\n"
+            << "       --checkpoint-interval SECONDS and --checkpoints N before any command set how often training is checkpointed and how many checkpoints are kept" << std::endl;
+  return 1;
+};
+
+static int invalidValue(const std::string &option, const std::string &value)
+{
+  std::cerr << "Invalid " << option << ": " << value << std::endl;
+  return printUsage();
+};
+
+enum class NetworkStart
+{
+  Resume,
+  Fresh
+};
+
+// Sets aiNetwork once the command's options are known and says where it came from
+static void startAINetwork(const NetworkStart &start, const bool &seeded, const uint64_t &seed)
+{
+  std::string source;
+  auto resume = start == NetworkStart::Resume;
+  if (resume && (aiNetwork = loadAINetwork(source)))
+  {
+    std::cout << "Resuming from " << source << std::endl;
+    return;
+  }
+  auto networkSeed = seeded ? seed : Random::entropySeed();
+  aiNetwork = createAINetwork(networkSeed);
+  std::cout << "Starting from a fresh network with seed " << networkSeed << (resume ? ", nothing to resume" : "") << std::endl;
+};
+
+int main(int argc, char **argv)
+{
+  setTraceThreadName("main");
+  auto networkStart = NetworkStart::Resume;
+  auto seeded = false;
+  for (int argIndex = 1; argIndex < argc; ++argIndex)
+  {
+    std::string arg(argv[argIndex]);
+    if (arg == "--grid" && argIndex + 1 < argc)
+    {
+      if (!parseGrid(argv[++argIndex], boardGridWidth, boardGridHeight))
+      {
+        std::cerr << "Invalid grid: " << argv[argIndex] << std::endl;
+        return 1;
+      }
+      // Keep large grids on screen unless a cell size is given afterwards
+      boardCellSize = std::max(1, std::min(20, 800 / std::max(boardGridWidth, boardGridHeight)));
+      continue;
+    }
+    if (arg == "--cell-size" && argIndex + 1 < argc)
+    {
+      if (!parseNumber(argv[++argIndex], boardCellSize))
+      {
+        return invalidValue(arg, argv[argIndex]);
+      }
+      boardCellSize = std::max(1, boardCellSize);
+      continue;
+    }
+    // Snake moves per second in play, 0 steps as fast as the simulation thread can
+    if (arg == "--tick-rate" && argIndex + 1 < argc)
+    {
+      if (!parseNumber(argv[++argIndex], boardTickRate))
+      {
+        return invalidValue(arg, argv[argIndex]);
+      }
+      boardTickRate = std::max(0.0, boardTickRate);
+      continue;
+    }
+    // Samples per training step of the Train AI scene
+    if (arg == "--batch" && argIndex + 1 < argc)
+    {
+      if (!parseNumber(argv[++argIndex], boardTrainingBatchSize))
+      {
+        return invalidValue(arg, argv[argIndex]);
+      }
+      boardTrainingBatchSize = std::max(1u, boardTrainingBatchSize);
+      continue;
+    }
+    if (arg == "--start" && argIndex + 1 < argc)
+    {
+      std::string start(argv[++argIndex]);
+      if (start != "resume" && start != "fresh")
+      {
+        return invalidValue(arg, start);
+      }
+      networkStart = start == "fresh" ? NetworkStart::Fresh : NetworkStart::Resume;
+      continue;
+    }
+    // Comes before the command, the trace is written when the program exits
+    if (arg == "--trace" && argIndex + 1 < argc)
+    {
+      startTracing(argv[++argIndex]);
+      continue;
+    }
+    if (arg == "--checkpoint-interval" && argIndex + 1 < argc)
+    {
+      if (!parseNumber(argv[++argIndex], checkpointOptions.intervalSeconds))
+      {
+        return invalidValue(arg, argv[argIndex]);
+      }
+      checkpointOptions.intervalSeconds = std::max(0.0, checkpointOptions.intervalSeconds);
+      continue;
+    }
+    if (arg == "--checkpoints" && argIndex + 1 < argc)
+    {
+      if (!parseNumber(argv[++argIndex], checkpointOptions.keep) || checkpointOptions.keep == 0)
+      {
+        return invalidValue(arg, argv[argIndex]);
+      }
+      continue;
+    }
+    if (arg == "--profile-overlay")
+    {
+#ifndef SNAKE_PROFILER
+      std::cerr << "Built without SNAKE_ENABLE_PROFILER, the overlay will stay empty" << std::endl;
+#endif
+      profilerOverlay = true;
+      continue;
+    }
+    if (arg == "--train")
+    {
+      TrainingOptions options;
+      for (++argIndex; argIndex < argc; ++argIndex)
+      {
+        std::string option(argv[argIndex]);
+        if (option == "--ticks" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.ticks))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--boards" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.boards) || options.boards == 0)
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--threads" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.threads))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--batch" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.batchSize))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+          options.batchSize = std::max(1u, options.batchSize);
+        }
+        else if (option == "--trainer" && argIndex + 1 < argc)
+        {
+          std::string trainer(argv[++argIndex]);
+          if (trainer != "batch" && trainer != "sgd")
+          {
+            return invalidValue(option, trainer);
+          }
+          options.batchedTraining = trainer == "batch";
+        }
+        else if (option == "--learning-rate" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.learningRate))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--replay" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.replayCapacity))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+          if (options.replayCapacity > ReplayBuffer::maxCapacity)
+          {
+            std::cerr << "--replay holds at most " << ReplayBuffer::maxCapacity << " samples ("
+                      << ReplayBuffer::maxCapacity * ReplayBuffer::bytesPerSample / (1 << 20) << " MB)" << std::endl;
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--replay-file" && argIndex + 1 < argc)
+        {
+          options.replayFile = argv[++argIndex];
+        }
+        else if (option == "--planner" && argIndex + 1 < argc)
+        {
+          std::string planner(argv[++argIndex]);
+          if (planner != "astar" && planner != "field")
+          {
+            return invalidValue(option, planner);
+          }
+          options.planner = planner == "field" ? Planner::DistanceField : Planner::AStar;
+        }
+        else if (option == "--inference" && argIndex + 1 < argc)
+        {
+          std::string inference(argv[++argIndex]);
+          if (inference != "float" && inference != "long-double")
+          {
+            return invalidValue(option, inference);
+          }
+          options.fastInference = inference == "float";
+        }
+        else if (option == "--sim" && argIndex + 1 < argc)
+        {
+          std::string simulation(argv[++argIndex]);
+          if (simulation != "batch" && simulation != "boards")
+          {
+            return invalidValue(option, simulation);
+          }
+          options.batchSimulation = simulation == "batch";
+        }
+        else if (option == "--grid" && argIndex + 1 < argc)
+        {
+          if (!parseGrid(argv[++argIndex], options.gridWidth, options.gridHeight))
+          {
+            std::cerr << "Invalid grid: " << argv[argIndex] << std::endl;
+            return 1;
+          }
+        }
+        else if (option == "--seed" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.seed))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+          seeded = true;
+        }
+        else
+        {
+          std::cerr << "Unknown training option: " << option << std::endl;
+          return 1;
+        }
+      }
+      startAINetwork(networkStart, seeded, options.seed);
+      runHeadlessTraining(options);
+      saveAINetwork();
+      return 0;
+    }
+    if (arg == "gen-dataset")
+    {
+      DatasetOptions options;
+      for (++argIndex; argIndex < argc; ++argIndex)
+      {
+        std::string option(argv[argIndex]);
+        if (option == "--out" && argIndex + 1 < argc)
+        {
+          options.directory = argv[++argIndex];
+        }
+        else if (option == "--samples" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.samples))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--boards" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.boards))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--threads" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.threads))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--shard-samples" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.shardSamples))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+          options.shardSamples = std::max(1ull, options.shardSamples);
+        }
+        else if (option == "--policy" && argIndex + 1 < argc)
+        {
+          std::string policy(argv[++argIndex]);
+          if (policy != "teacher" && policy != "random")
+          {
+            return invalidValue(option, policy);
+          }
+          options.policy = policy == "random" ? DatasetPolicy::Random : DatasetPolicy::Teacher;
+        }
+        else if (option == "--random-moves" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.randomMoves))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--planner" && argIndex + 1 < argc)
+        {
+          std::string planner(argv[++argIndex]);
+          if (planner != "astar" && planner != "field")
+          {
+            return invalidValue(option, planner);
+          }
+          options.planner = planner == "field" ? Planner::DistanceField : Planner::AStar;
+        }
+        else if (option == "--grid" && argIndex + 1 < argc)
+        {
+          if (!parseGrid(argv[++argIndex], options.gridWidth, options.gridHeight))
+          {
+            std::cerr << "Invalid grid: " << argv[argIndex] << std::endl;
+            return 1;
+          }
+        }
+        else if (option == "--seed" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.seed))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else
+        {
+          std::cerr << "Unknown dataset option: " << option << std::endl;
+          return 1;
+        }
+      }
+      return generateDataset(options) ? 0 : 1;
+    }
+    if (arg == "train-offline")
+    {
+      OfflineTrainingOptions options;
+      for (++argIndex; argIndex < argc; ++argIndex)
+      {
+        std::string option(argv[argIndex]);
+        if (option == "--data" && argIndex + 1 < argc)
+        {
+          options.directory = argv[++argIndex];
+        }
+        else if (option == "--epochs" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.epochs))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--batch" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.batchSize))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+          options.batchSize = std::max(1u, options.batchSize);
+        }
+        else if (option == "--learning-rate" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.learningRate))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--shuffle" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.shuffleWindow))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--seed" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.seed))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+          seeded = true;
+        }
+        else
+        {
+          std::cerr << "Unknown offline training option: " << option << std::endl;
+          return 1;
+        }
+      }
+      startAINetwork(networkStart, seeded, options.seed);
+      trainOffline(options);
+      saveAINetwork();
+      return 0;
+    }
+    if (arg == "evolve")
+    {
+      EvolutionOptions options;
+      for (++argIndex; argIndex < argc; ++argIndex)
+      {
+        std::string option(argv[argIndex]);
+        if (option == "--generations" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.generations))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--population" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.population) || options.population < 2)
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--episodes" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.episodes))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--elites" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.elites))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--crossover" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.crossoverRate))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--mutation-rate" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.mutationRate))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--mutation-strength" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.mutationStrength))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--threads" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.threads))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+        }
+        else if (option == "--grid" && argIndex + 1 < argc)
+        {
+          if (!parseGrid(argv[++argIndex], options.gridWidth, options.gridHeight))
+          {
+            std::cerr << "Invalid grid: " << argv[argIndex] << std::endl;
+            return 1;
+          }
+        }
+        else if (option == "--seed" && argIndex + 1 < argc)
+        {
+          if (!parseNumber(argv[++argIndex], options.seed))
+          {
+            return invalidValue(option, argv[argIndex]);
+          }
+          seeded = true;
+        }
+        else
+        {
+          std::cerr << "Unknown evolution option: " << option << std::endl;
+          return 1;
+        }
+      }
+      startAINetwork(networkStart, seeded, options.seed);
+      runEvolution(options);
+      saveAINetwork();
+      return 0;
+    }
+    return printUsage();
+  }
+  startAINetwork(networkStart, false, 0);
+  CheckpointThread checkpoints(checkpointOptions.intervalSeconds);
+  Visualizer visualizer(*aiNetwork, 640, 480);
+  auto boardWidth = boardGridWidth * boardCellSize;
+  auto boardHeight = boardGridHeight * boardCellSize;
+  SnakeGame game((boardWidth * 2) + (boardWidth / 2), boardHeight + (boardHeight / 2));
+  game.awaitWindowThread();
+  visualizer.close();
+  visualizer.awaitWindowThread();
+  saveAINetwork();
+};